@@ -0,0 +1,233 @@
+// microbenchmarks of the parts every simulation spends it's time in, meant to be built in release mode
+// run with --benchmark_format=json or --benchmark_out=<file> for results that can be compared between builds
+#include <benchmark/benchmark.h>
+
+#include <cmath>
+#include <cstddef>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "cortisol_cytokines_integrator.hpp"
+#include "cortisol_cytokines_model.hpp"
+#include "cortisol_cytokines_values.hpp"
+#include "daily_statistics.hpp"
+#include "trajectory.hpp"
+#include "utilities.hpp"
+
+// samples spread over a day, so that the glucose curve is read all over it
+static constexpr std::size_t TIME_COUNT = 1024;
+
+static const std::vector<std::string> HEADER = {"Time", "Antigens", "Active Macrophages", "Resting Macrophages", "IL10", "IL6", "IL8", "TNF-ɑ", "Cortisol"};
+
+static std::vector<double> dayTimes(double start_time = 0) {
+    std::vector<double> times(TIME_COUNT);
+
+    for (std::size_t i = 0; i < TIME_COUNT; i++) {
+        times[i] = start_time + double(i) / TIME_COUNT;
+    }
+
+    return times;
+}
+
+// the trajectory of the default configuration over the given days, observing every step
+static Trajectory simulatedTrajectory(int days) {
+    CortisolCytokinesModel model;
+    CortisolCytokinesModel::State state = CortisolCytokinesModel::DEFAULT_INITIAL_CONDITIONS;
+    Trajectory trajectory;
+
+    CortisolCytokinesIntegrator().integrate(model, state, 0.0, double(days), Utilities::IntegralObserver(trajectory));
+
+    return trajectory;
+}
+
+// a state a couple of days into the default simulation, where every variable is away from it's initial value
+static CortisolCytokinesModel::State settledState() {
+    CortisolCytokinesModel model;
+    CortisolCytokinesModel::State state = CortisolCytokinesModel::DEFAULT_INITIAL_CONDITIONS;
+
+    CortisolCytokinesIntegrator().integrate(model, state, 0.0, 2.0);
+
+    return state;
+}
+
+static void BM_RightHandSide(benchmark::State &benchmark_state) {
+    const CortisolCytokinesModel model;
+    const CortisolCytokinesModel::State x = settledState();
+    const std::vector<double> times = dayTimes();
+    CortisolCytokinesModel::State dxdt;
+    std::size_t i = 0;
+
+    for (auto _ : benchmark_state) {
+        model(x, dxdt, times[i++ % TIME_COUNT]);
+        benchmark::DoNotOptimize(dxdt);
+    }
+
+    benchmark_state.SetItemsProcessed(benchmark_state.iterations());
+}
+BENCHMARK(BM_RightHandSide);
+
+static void BM_Jacobian(benchmark::State &benchmark_state) {
+    const CortisolCytokinesModel model;
+    const CortisolCytokinesModel::State x = settledState();
+    const std::vector<double> times = dayTimes();
+    CortisolCytokinesModel::Jacobian J;
+    CortisolCytokinesModel::State dfdt;
+    std::size_t i = 0;
+
+    for (auto _ : benchmark_state) {
+        model.jacobian(x, J, times[i++ % TIME_COUNT], dfdt);
+        benchmark::DoNotOptimize(J);
+        benchmark::DoNotOptimize(dfdt);
+    }
+
+    benchmark_state.SetItemsProcessed(benchmark_state.iterations());
+}
+BENCHMARK(BM_Jacobian);
+
+// the glucose curve is read at the time of day, around midnight it wraps from the end of the table to it's start
+static void BM_GlucoseLookup(benchmark::State &benchmark_state) {
+    const CortisolCytokinesValues values;
+    const Utilities::LookupTable table(values.gluc, Utilities::LookupTable::Interpolation(benchmark_state.range(0)));
+    // the last and first tenth of a day
+    std::vector<double> times(TIME_COUNT);
+
+    for (std::size_t i = 0; i < TIME_COUNT; i++) {
+        times[i] = 0.9 + 0.2 * double(i) / TIME_COUNT;
+    }
+
+    for (auto _ : benchmark_state) {
+        for (const double T : times) {
+            benchmark::DoNotOptimize(table(T - int(T)));
+        }
+    }
+
+    benchmark_state.SetItemsProcessed(benchmark_state.iterations() * TIME_COUNT);
+}
+BENCHMARK(BM_GlucoseLookup)
+    ->ArgName("interpolation")
+    ->Arg(int(Utilities::LookupTable::Interpolation::Nearest))
+    ->Arg(int(Utilities::LookupTable::Interpolation::Linear))
+    ->Arg(int(Utilities::LookupTable::Interpolation::Cubic));
+
+// one simulated day with each solver, from a state that has settled into the daily cycle
+static void BM_IntegrateDay(benchmark::State &benchmark_state) {
+    const CortisolCytokinesModel model;
+    const CortisolCytokinesModel::State start_state = settledState();
+    const CortisolCytokinesIntegrator integrator(CortisolCytokinesIntegrator::Solver(benchmark_state.range(0)));
+    std::size_t steps = 0;
+
+    for (auto _ : benchmark_state) {
+        CortisolCytokinesModel::State state = start_state;
+
+        steps += integrator.integrate(model, state, 2.0, 3.0);
+        benchmark::DoNotOptimize(state);
+    }
+
+    benchmark_state.counters["steps"] = benchmark::Counter(double(steps), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_IntegrateDay)
+    ->ArgName("solver")
+    ->Arg(int(CortisolCytokinesIntegrator::Solver::Dopri5))
+    ->Arg(int(CortisolCytokinesIntegrator::Solver::CashKarp54))
+    ->Arg(int(CortisolCytokinesIntegrator::Solver::Rosenbrock4))
+    ->Unit(benchmark::kMillisecond);
+
+// storing the samples of a day's worth of steps
+static void BM_IntegralObserver(benchmark::State &benchmark_state) {
+    const Trajectory source = simulatedTrajectory(1);
+    const auto columns = source.columns();
+    CortisolCytokinesModel::State x;
+
+    for (auto _ : benchmark_state) {
+        Trajectory trajectory;
+        Utilities::IntegralObserver observer(trajectory);
+
+        for (std::size_t row = 0; row < source.size(); row++) {
+            for (std::size_t i = 0; i < x.size(); i++) {
+                x[i] = columns[i + 1][row];
+            }
+
+            observer(x, columns[0][row]);
+        }
+
+        benchmark::DoNotOptimize(trajectory);
+    }
+
+    benchmark_state.SetItemsProcessed(benchmark_state.iterations() * source.size());
+}
+BENCHMARK(BM_IntegralObserver);
+
+static void BM_DailyStatistics(benchmark::State &benchmark_state) {
+    const Trajectory source = simulatedTrajectory(10);
+    const auto columns = source.columns();
+    CortisolCytokinesModel::State x;
+
+    for (auto _ : benchmark_state) {
+        Utilities::DailyStatistics daily_statistics;
+
+        for (std::size_t row = 0; row < source.size(); row++) {
+            for (std::size_t i = 0; i < x.size(); i++) {
+                x[i] = columns[i + 1][row];
+            }
+
+            daily_statistics(x, columns[0][row]);
+        }
+
+        daily_statistics.finish();
+        benchmark::DoNotOptimize(daily_statistics);
+    }
+
+    benchmark_state.SetItemsProcessed(benchmark_state.iterations() * source.size());
+}
+BENCHMARK(BM_DailyStatistics);
+
+// writes a hundred days of samples, the argument is the significant digits or 0 for the shortest round trip
+static void BM_WriteCsv(benchmark::State &benchmark_state) {
+    const Trajectory trajectory = simulatedTrajectory(100);
+    const std::filesystem::path file_path = std::filesystem::temp_directory_path() / "immuno-endocrine-benchmark.csv";
+    const std::optional<int> precision = benchmark_state.range(0) > 0 ? std::optional<int>(int(benchmark_state.range(0))) : std::nullopt;
+
+    for (auto _ : benchmark_state) {
+        Utilities::writeCsv(HEADER, trajectory.columns(), file_path, precision);
+    }
+
+    benchmark_state.SetItemsProcessed(benchmark_state.iterations() * trajectory.size());
+    benchmark_state.SetBytesProcessed(benchmark_state.iterations() * std::filesystem::file_size(file_path));
+    std::filesystem::remove(file_path);
+}
+BENCHMARK(BM_WriteCsv)->ArgName("precision")->Arg(0)->Arg(6)->Unit(benchmark::kMillisecond);
+
+static void BM_WriteBinary(benchmark::State &benchmark_state) {
+    const Trajectory trajectory = simulatedTrajectory(100);
+    const std::filesystem::path file_path = std::filesystem::temp_directory_path() / "immuno-endocrine-benchmark.bin";
+
+    for (auto _ : benchmark_state) {
+        Utilities::BinarySink sink(HEADER, file_path);
+        sink.writeBlock(trajectory);
+        sink.close();
+    }
+
+    benchmark_state.SetItemsProcessed(benchmark_state.iterations() * trajectory.size());
+    benchmark_state.SetBytesProcessed(benchmark_state.iterations() * std::filesystem::file_size(file_path));
+    std::filesystem::remove(file_path);
+}
+BENCHMARK(BM_WriteBinary)->Unit(benchmark::kMillisecond);
+
+// preparing a series for a figure 560 pixels wide, matplot++'s default
+static void BM_DecimateMinMax(benchmark::State &benchmark_state) {
+    const Trajectory trajectory = simulatedTrajectory(10);
+
+    for (auto _ : benchmark_state) {
+        for (std::size_t i = 0; i < trajectory.stateSize(); i++) {
+            benchmark::DoNotOptimize(Utilities::decimateMinMax(trajectory.times(), trajectory.state(i), 560));
+        }
+    }
+
+    benchmark_state.SetItemsProcessed(benchmark_state.iterations() * trajectory.size() * trajectory.stateSize());
+}
+BENCHMARK(BM_DecimateMinMax);
+
+BENCHMARK_MAIN();
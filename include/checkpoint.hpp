@@ -0,0 +1,44 @@
+#ifndef __CHECKPOINT_HPP__
+#define __CHECKPOINT_HPP__
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <vector>
+
+namespace Utilities {
+    // everything needed to continue an integration where it stopped, stored as:
+    //  "IECPCKPT", uint64 state size, state, time, step size, uint64 output size
+    // followed by the cycle search of runs looking for the steady state:
+    //  origin, uint64 periods, section (state size), uint8 reached, cycle time, uint64 sample count,
+    //  samples (time followed by the state)
+    // all numbers in native byte order, the output size is the length of the streamed output at the time
+    // of the checkpoint, anything written after it is discarded when resuming
+    struct Checkpoint {
+        // CortisolCytokinesIntegrator::CycleSearch, so that a resumed run doesn't start looking over again
+        struct CycleSearch {
+            double origin = 0;
+            std::uint64_t periods = 0;
+            std::vector<double> section;
+            bool reached = false;
+            double cycle_time = 0;
+            // the time of each sample followed by it's state
+            std::vector<double> cycle;
+        };
+
+        std::vector<double> state;
+        double time = 0;
+        double step_size = 0;
+        std::uintmax_t output_size = 0;
+        // checkpoints of runs that don't look for the steady state end before it
+        std::optional<CycleSearch> cycle_search;
+
+        // throws std::runtime_error if the file can't be read or isn't a checkpoint
+        static Checkpoint read(const std::filesystem::path &file_path);
+        // writes to a temporary file first and renames it over the previous checkpoint, so that being
+        // interrupted while writing never leaves a corrupted checkpoint behind
+        void write(const std::filesystem::path &file_path) const;
+    };
+}  // namespace Utilities
+
+#endif
@@ -0,0 +1,246 @@
+#ifndef __CORTISOL_CYTOKINES_BATCH_MODEL_HPP__
+#define __CORTISOL_CYTOKINES_BATCH_MODEL_HPP__
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "cortisol_cytokines_model.hpp"
+#include "cortisol_cytokines_values.hpp"
+#include "utilities.hpp"
+
+// the same equations as CortisolCytokinesModel evaluated for LANES parameter sets at once
+// states and parameters are stored as one array per variable with one element per parameter set so
+// that every equation becomes a loop over the parameter sets the compiler can vectorize
+// all the parameter sets must share the same glucose curve
+template<std::size_t LANES>
+class CortisolCytokinesBatchModel {
+    public:
+        using Lanes = std::array<double, LANES>;
+        static constexpr std::size_t STATE_SIZE = std::tuple_size_v<CortisolCytokinesModel::State>;
+        // variable major, the value of variable i for parameter set j is at i * LANES + j
+        using State = std::array<double, STATE_SIZE * LANES>;
+
+    private:
+        struct Exponent {
+                Lanes value;
+                // x^h for a negative x is only defined for an integer h, in which case it's sign
+                // depends on h being even or odd
+                Lanes negative_sign;
+        };
+
+        struct Parameters {
+                Lanes beta_a, k_a, m_a, k_m, k_mtnf, k_ma, k_mr, mr_max;
+                Lanes k_10m, k_106, k_10, q_il10;
+                Lanes k_6m, k_6tnf, klt6, kmct, k_6, q_il6;
+                Lanes k_8m, k_8tnf, k_8, q_il8;
+                Lanes k_tnfm, klt, k_tnf, q_tnf;
+                Lanes ktc, kmtc, cmax, kcd;
+
+                Lanes n_106_h_106, n_610_h_610, n_66_h_66, n_6tnf_h_6tnf, n_tnf6_h_tnf6;
+                Lanes n_810_h_610_over_h_810, n_8tnf_h_8tnf, n_m10_h_m10, n_tnf10_h_tnf10, n_mtnf_h_mtnf;
+
+                Exponent h_106, h_66, h_6tnf, h_tnf6, h_810, h_8tnf, h_m10, h_tnf10, h_mtnf, n_610;
+
+                Utilities::LookupTable gluc_table;
+        };
+
+        std::shared_ptr<const Parameters> parameters;
+
+        // x^h built on the vectorizable exp and log
+        static inline double power(double x, double exponent, double negative_sign) {
+            const double magnitude = Utilities::vectorizableExp(exponent * Utilities::vectorizableLog(std::fabs(x)));
+            const double result = x < 0 ? negative_sign * magnitude : magnitude;
+
+            // vectorizableLog doesn't return -inf for 0, so it's handled separately, 0^0 is 1 like in std::pow
+            return x == 0 ? (exponent == 0 ? 1.0 : 0.0) : result;
+        }
+
+    public:
+        explicit CortisolCytokinesBatchModel(const std::vector<std::shared_ptr<const CortisolCytokinesValues>> &values) {
+            if (values.size() != LANES) {
+                throw std::invalid_argument("Batch model requires exactly one parameter set per lane");
+            }
+
+            auto lanes = [&values](double CortisolCytokinesValues::*member) -> Lanes {
+                Lanes lanes;
+
+                for (std::size_t lane = 0; lane < LANES; lane++) {
+                    lanes[lane] = (*values[lane]).*member;
+                }
+
+                return lanes;
+            };
+
+            auto exponent = [&lanes](double CortisolCytokinesValues::*member) -> Exponent {
+                Exponent exponent = {lanes(member), {}};
+
+                for (std::size_t lane = 0; lane < LANES; lane++) {
+                    const double value = exponent.value[lane];
+
+                    if (value != std::trunc(value)) {
+                        exponent.negative_sign[lane] = std::numeric_limits<double>::quiet_NaN();
+                    } else {
+                        exponent.negative_sign[lane] = std::fmod(value, 2) == 0 ? 1 : -1;
+                    }
+                }
+
+                return exponent;
+            };
+
+            auto parameters = std::make_shared<Parameters>();
+
+            parameters->beta_a = lanes(&CortisolCytokinesValues::beta_a);
+            parameters->k_a = lanes(&CortisolCytokinesValues::k_a);
+            parameters->m_a = lanes(&CortisolCytokinesValues::m_a);
+            parameters->k_m = lanes(&CortisolCytokinesValues::k_m);
+            parameters->k_mtnf = lanes(&CortisolCytokinesValues::k_mtnf);
+            parameters->k_ma = lanes(&CortisolCytokinesValues::k_ma);
+            parameters->k_mr = lanes(&CortisolCytokinesValues::k_mr);
+            parameters->mr_max = lanes(&CortisolCytokinesValues::mr_max);
+            parameters->k_10m = lanes(&CortisolCytokinesValues::k_10m);
+            parameters->k_106 = lanes(&CortisolCytokinesValues::k_106);
+            parameters->k_10 = lanes(&CortisolCytokinesValues::k_10);
+            parameters->q_il10 = lanes(&CortisolCytokinesValues::q_il10);
+            parameters->k_6m = lanes(&CortisolCytokinesValues::k_6m);
+            parameters->k_6tnf = lanes(&CortisolCytokinesValues::k_6tnf);
+            parameters->klt6 = lanes(&CortisolCytokinesValues::klt6);
+            parameters->kmct = lanes(&CortisolCytokinesValues::kmct);
+            parameters->k_6 = lanes(&CortisolCytokinesValues::k_6);
+            parameters->q_il6 = lanes(&CortisolCytokinesValues::q_il6);
+            parameters->k_8m = lanes(&CortisolCytokinesValues::k_8m);
+            parameters->k_8tnf = lanes(&CortisolCytokinesValues::k_8tnf);
+            parameters->k_8 = lanes(&CortisolCytokinesValues::k_8);
+            parameters->q_il8 = lanes(&CortisolCytokinesValues::q_il8);
+            parameters->k_tnfm = lanes(&CortisolCytokinesValues::k_tnfm);
+            parameters->klt = lanes(&CortisolCytokinesValues::klt);
+            parameters->k_tnf = lanes(&CortisolCytokinesValues::k_tnf);
+            parameters->q_tnf = lanes(&CortisolCytokinesValues::q_tnf);
+            parameters->ktc = lanes(&CortisolCytokinesValues::ktc);
+            parameters->kmtc = lanes(&CortisolCytokinesValues::kmtc);
+            parameters->cmax = lanes(&CortisolCytokinesValues::cmax);
+            parameters->kcd = lanes(&CortisolCytokinesValues::kcd);
+
+            parameters->n_106_h_106 = lanes(&CortisolCytokinesValues::n_106_h_106);
+            parameters->n_610_h_610 = lanes(&CortisolCytokinesValues::n_610_h_610);
+            parameters->n_66_h_66 = lanes(&CortisolCytokinesValues::n_66_h_66);
+            parameters->n_6tnf_h_6tnf = lanes(&CortisolCytokinesValues::n_6tnf_h_6tnf);
+            parameters->n_tnf6_h_tnf6 = lanes(&CortisolCytokinesValues::n_tnf6_h_tnf6);
+            parameters->n_810_h_610_over_h_810 = lanes(&CortisolCytokinesValues::n_810_h_610_over_h_810);
+            parameters->n_8tnf_h_8tnf = lanes(&CortisolCytokinesValues::n_8tnf_h_8tnf);
+            parameters->n_m10_h_m10 = lanes(&CortisolCytokinesValues::n_m10_h_m10);
+            parameters->n_tnf10_h_tnf10 = lanes(&CortisolCytokinesValues::n_tnf10_h_tnf10);
+            parameters->n_mtnf_h_mtnf = lanes(&CortisolCytokinesValues::n_mtnf_h_mtnf);
+
+            parameters->h_106 = exponent(&CortisolCytokinesValues::h_106);
+            parameters->h_66 = exponent(&CortisolCytokinesValues::h_66);
+            parameters->h_6tnf = exponent(&CortisolCytokinesValues::h_6tnf);
+            parameters->h_tnf6 = exponent(&CortisolCytokinesValues::h_tnf6);
+            parameters->h_810 = exponent(&CortisolCytokinesValues::h_810);
+            parameters->h_8tnf = exponent(&CortisolCytokinesValues::h_8tnf);
+            parameters->h_m10 = exponent(&CortisolCytokinesValues::h_m10);
+            parameters->h_tnf10 = exponent(&CortisolCytokinesValues::h_tnf10);
+            parameters->h_mtnf = exponent(&CortisolCytokinesValues::h_mtnf);
+            parameters->n_610 = exponent(&CortisolCytokinesValues::n_610);
+
+            parameters->gluc_table = values.front()->gluc_table;
+
+            this->parameters = std::move(parameters);
+        }
+
+        static State pack(const std::array<CortisolCytokinesModel::State, LANES> &states) {
+            State packed;
+
+            for (std::size_t lane = 0; lane < LANES; lane++) {
+                for (std::size_t i = 0; i < STATE_SIZE; i++) {
+                    packed[i * LANES + lane] = states[lane][i];
+                }
+            }
+
+            return packed;
+        }
+
+        static CortisolCytokinesModel::State unpack(const State &packed, std::size_t lane) {
+            CortisolCytokinesModel::State state;
+
+            for (std::size_t i = 0; i < STATE_SIZE; i++) {
+                state[i] = packed[i * LANES + lane];
+            }
+
+            return state;
+        }
+
+        void operator()(const State &x, State &dxdt, const double T) const {
+            const Parameters &values = *this->parameters;
+            const double GLUCOSE = values.gluc_table(T - int(T));
+            // writing into a local state lets the compiler know it can't overlap x or the parameters,
+            // otherwise it won't vectorize the loop
+            State derivatives;
+
+            // see CortisolCytokinesModel::operator() for the scalar version of each of the equations
+            for (std::size_t lane = 0; lane < LANES; lane++) {
+                const double A = x[0 * LANES + lane];
+                const double MA = x[1 * LANES + lane];
+                const double MR = x[2 * LANES + lane];
+                const double IL10 = x[3 * LANES + lane];
+                const double IL6 = x[4 * LANES + lane];
+                const double IL8 = x[5 * LANES + lane];
+                const double TNF = x[6 * LANES + lane];
+                const double COR = x[7 * LANES + lane];
+
+                const double TNF_H_MTNF = power(TNF, values.h_mtnf.value[lane], values.h_mtnf.negative_sign[lane]);
+                const double MACROPHAGE_ACTIVATION = (values.k_m[lane] + values.k_mtnf[lane] *
+                                                                             (TNF_H_MTNF / (values.n_mtnf_h_mtnf[lane] + TNF_H_MTNF)) *
+                                                                             (values.n_m10_h_m10[lane] / (values.n_m10_h_m10[lane] + power(IL10, values.h_m10.value[lane], values.h_m10.negative_sign[lane])))
+                                                     ) *
+                                                     MR * A;
+                const double CORTISOL_INHIBITION = COR * (1 - COR / (COR + values.kmct[lane]));
+
+                derivatives[0 * LANES + lane] = values.beta_a[lane] * A * (1 - (A / values.k_a[lane])) -
+                                         values.m_a[lane] * A * MA;
+
+                derivatives[1 * LANES + lane] = MACROPHAGE_ACTIVATION - values.k_ma[lane] * MA;
+
+                derivatives[2 * LANES + lane] = -MACROPHAGE_ACTIVATION + values.k_mr[lane] * MR * (1 - MR / values.mr_max[lane]);
+
+                const double IL6_H_106 = power(IL6, values.h_106.value[lane], values.h_106.negative_sign[lane]);
+                derivatives[3 * LANES + lane] = (values.k_10m[lane] + values.k_106[lane] * (IL6_H_106 / (values.n_106_h_106[lane] + IL6_H_106))) * MA -
+                                         values.k_10[lane] * (IL10 - values.q_il10[lane]);
+
+                const double TNF_H_6TNF = power(TNF, values.h_6tnf.value[lane], values.h_6tnf.negative_sign[lane]);
+                derivatives[4 * LANES + lane] = (values.k_6m[lane] + values.k_6tnf[lane] *
+                                                                  (TNF_H_6TNF / (values.n_6tnf_h_6tnf[lane] + TNF_H_6TNF)) *
+                                                                  (values.n_66_h_66[lane] / (values.n_66_h_66[lane] + power(IL6, values.h_66.value[lane], values.h_66.negative_sign[lane]))) *
+                                                                  (values.n_610_h_610[lane] / (values.n_610_h_610[lane] + power(IL10, values.n_610.value[lane], values.n_610.negative_sign[lane])))
+                                         ) * MA -
+                                         values.klt6[lane] * CORTISOL_INHIBITION -
+                                         values.k_6[lane] * (IL6 - values.q_il6[lane]);
+
+                const double TNF_H_8TNF = power(TNF, values.h_8tnf.value[lane], values.h_8tnf.negative_sign[lane]);
+                derivatives[5 * LANES + lane] = (values.k_8m[lane] + values.k_8tnf[lane] *
+                                                                  (TNF_H_8TNF / (TNF_H_8TNF + values.n_8tnf_h_8tnf[lane])) *
+                                                                  (values.n_810_h_610_over_h_810[lane] + power(IL10, values.h_810.value[lane], values.h_810.negative_sign[lane]))
+                                         ) * MA -
+                                         values.k_8[lane] * (IL8 - values.q_il8[lane]);
+
+                derivatives[6 * LANES + lane] = (values.k_tnfm[lane] *
+                                          (values.n_tnf6_h_tnf6[lane] / (values.n_tnf6_h_tnf6[lane] + power(IL6, values.h_tnf6.value[lane], values.h_tnf6.negative_sign[lane]))) *
+                                          (values.n_tnf10_h_tnf10[lane] / (values.n_tnf10_h_tnf10[lane] + power(IL10, values.h_tnf10.value[lane], values.h_tnf10.negative_sign[lane])))
+                                         ) * MA -
+                                         values.klt[lane] * CORTISOL_INHIBITION -
+                                         values.k_tnf[lane] * (TNF - values.q_tnf[lane]);
+
+                derivatives[7 * LANES + lane] = values.ktc[lane] * (TNF / (TNF + values.kmtc[lane])) *
+                                             (values.cmax[lane] - COR) * GLUCOSE -
+                                         values.kcd[lane] * COR;
+            }
+
+            dxdt = derivatives;
+        }
+};
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef __CORTISOL_CYTOKINES_CONFIGURATION_HPP__
+#define __CORTISOL_CYTOKINES_CONFIGURATION_HPP__
+
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <nlohmann/json.hpp>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "cortisol_cytokines_integrator.hpp"
+#include "cortisol_cytokines_model.hpp"
+#include "cortisol_cytokines_values.hpp"
+
+// everything a configuration file sets up for a simulation, validated once when it's read or built
+// copies share the parameter block, so a configuration can be parsed once and copied for every run, changing
+// a parameter replaces the block of that copy only
+class CortisolCytokinesConfiguration {
+    private:
+        std::shared_ptr<const CortisolCytokinesValues> values;
+        CortisolCytokinesModel::State initial_conditions = CortisolCytokinesModel::DEFAULT_INITIAL_CONDITIONS;
+        CortisolCytokinesIntegrator integrator;
+
+    public:
+        // a file that can't be read or parsed, the nlohmann::json::parse_error behind it is nested in it
+        class FileError : public std::runtime_error {
+            public:
+                explicit FileError(const std::filesystem::path &file_path);
+        };
+
+        // the default parameters and initial conditions, integrated with the default solver
+        CortisolCytokinesConfiguration();
+        // throws nlohmann::json::exception for missing or mistyped attributes and std::invalid_argument for
+        // invalid values
+        static CortisolCytokinesConfiguration fromJson(const nlohmann::basic_json<> &json_file);
+        // same as fromJson, also throws FileError when the file can't be read or parsed
+        static CortisolCytokinesConfiguration readFile(const std::filesystem::path &file_path);
+        // parses any json file, throws FileError when it can't be read or parsed
+        static nlohmann::json readJson(const std::filesystem::path &file_path);
+
+        // the values are validated, throws std::invalid_argument
+        void setValues(std::shared_ptr<const CortisolCytokinesValues> values);
+        void setInitialConditions(const CortisolCytokinesModel::State &initial_conditions);
+        void setIntegrator(const CortisolCytokinesIntegrator &integrator);
+        // by the name it has on the configuration file, throws std::out_of_range for unknown names and
+        // std::invalid_argument for values that aren't finite
+        void setParameter(std::string_view name, double value);
+        // same as setParameter for each of them, copying the parameter block only once
+        void setParameters(const std::map<std::string, double> &parameters);
+        double getParameter(std::string_view name) const;
+
+        const std::shared_ptr<const CortisolCytokinesValues> &getValues() const;
+        const CortisolCytokinesModel::State &getInitialConditions() const;
+        const CortisolCytokinesIntegrator &getIntegrator() const;
+        // sharing the parameter block of the configuration
+        CortisolCytokinesModel getModel() const;
+
+        // throws std::invalid_argument if any parameter or initial condition isn't finite, an initial
+        // condition is negative or there's no glucose curve
+        static void validate(const CortisolCytokinesValues &values);
+        static void validate(const CortisolCytokinesModel::State &initial_conditions);
+};
+
+#endif
@@ -0,0 +1,529 @@
+#ifndef __CORTISOL_CYTOKINES_INTEGRATOR_HPP__
+#define __CORTISOL_CYTOKINES_INTEGRATOR_HPP__
+
+#include <boost/numeric/odeint/integrate/integrate_adaptive.hpp>
+#include <boost/numeric/odeint/integrate/integrate_const.hpp>
+#include <boost/numeric/odeint/integrate/integrate_times.hpp>
+#include <boost/numeric/odeint/integrate/null_observer.hpp>
+#include <boost/numeric/odeint/stepper/controlled_runge_kutta.hpp>
+#include <boost/numeric/odeint/stepper/dense_output_runge_kutta.hpp>
+#include <boost/numeric/odeint/stepper/rosenbrock4.hpp>
+#include <boost/numeric/odeint/stepper/rosenbrock4_controller.hpp>
+#include <boost/numeric/odeint/stepper/rosenbrock4_dense_output.hpp>
+#include <boost/numeric/odeint/stepper/runge_kutta4.hpp>
+#include <boost/numeric/odeint/stepper/runge_kutta_cash_karp54.hpp>
+#include <boost/numeric/odeint/stepper/runge_kutta_dopri5.hpp>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <functional>
+#include <limits>
+#include <nlohmann/json.hpp>
+#include <optional>
+#include <ranges>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "cortisol_cytokines_model.hpp"
+
+// single place where the way the model is integrated is defined, shared by every kind of run
+class CortisolCytokinesIntegrator {
+    public:
+        enum class Solver {
+            // explicit dormand-prince 5(4), what odeint's integrate function defaults to
+            Dopri5,
+            // explicit cash-karp 5(4)
+            CashKarp54,
+            // implicit rosenbrock 4(3) using the analytic jacobian of the model, it's step size isn't bound by
+            // the stiff tnf-alpha clearance, so it takes fewer steps than the explicit methods at loose tolerances
+            Rosenbrock4
+        };
+
+        static constexpr double INITIAL_STEP = 0.0001;
+        // odeint's defaults
+        static constexpr double ABSOLUTE_TOLERANCE = 1e-6;
+        static constexpr double RELATIVE_TOLERANCE = 1e-6;
+
+        // throws std::invalid_argument for unknown names
+        static Solver parseSolver(const std::string &name);
+        // the name parseSolver reads
+        static std::string solverName(Solver solver);
+
+        // settings given on the command line, each of them replaces the one read from a file when set
+        struct Overrides {
+            std::optional<Solver> solver;
+            std::optional<double> absolute_tolerance;
+            std::optional<double> relative_tolerance;
+            // in days
+            std::optional<double> output_interval;
+        };
+
+        // counts what the solver did, filled in while integrating once it's attached with setStatistics
+        struct Statistics {
+            // accepted step sizes are binned by their decade, from 1e-12 days and below up to 1 day and above
+            static constexpr int SMALLEST_STEP_DECADE = -12;
+            static constexpr std::size_t STEP_SIZE_BINS = 13;
+
+            std::size_t rhs_evaluations = 0;
+            std::size_t jacobian_evaluations = 0;
+            std::size_t accepted_steps = 0;
+            std::size_t rejected_steps = 0;
+            std::array<std::size_t, STEP_SIZE_BINS> step_size_histogram = {};
+
+            inline void recordStep(double step_size, bool accepted) {
+                if (!accepted) {
+                    this->rejected_steps++;
+
+                    return;
+                }
+
+                const int decade = int(std::floor(std::log10(std::fabs(step_size)))) - SMALLEST_STEP_DECADE;
+
+                this->accepted_steps++;
+                this->step_size_histogram[std::size_t(std::clamp(decade, 0, int(STEP_SIZE_BINS) - 1))]++;
+            }
+        };
+
+        // how far continuePeriodic got looking for the cycle, kept between integrations that continue each other
+        struct CycleSearch {
+            // start of the first period
+            double origin = 0;
+            // completed periods, counted so that their ends don't drift with rounding errors
+            std::size_t periods = 0;
+            // state at the start of the current period
+            CortisolCytokinesModel::State section = {};
+            bool reached = false;
+            // only meaningful once the cycle is reached
+            double cycle_time = 0;
+            // samples of the current period, or of the cycle once it's reached, it's start is left out since it's
+            // the end of the period before
+            std::vector<std::pair<CortisolCytokinesModel::State, double>> cycle;
+        };
+
+    private:
+        Solver solver;
+        double absolute_tolerance;
+        double relative_tolerance;
+        // in days, 0 observes every step the solver takes
+        double output_interval;
+        double initial_step = INITIAL_STEP;
+        // not owned, nothing is counted while it's null
+        Statistics *statistics = nullptr;
+
+        // the model as the explicit steppers see it, counting it's evaluations
+        struct CountedSystem {
+            const CortisolCytokinesModel &model;
+            Statistics *statistics;
+
+            inline void operator()(const CortisolCytokinesModel::State &x, CortisolCytokinesModel::State &dxdt, double T) const {
+                if (this->statistics != nullptr) {
+                    this->statistics->rhs_evaluations++;
+                }
+
+                model(x, dxdt, T);
+            }
+        };
+
+        // rosenbrock4 needs ublas containers, these adapt the model to them
+        using ImplicitState = boost::numeric::ublas::vector<double>;
+        using ImplicitJacobian = boost::numeric::ublas::matrix<double>;
+
+        struct ImplicitSystem {
+            const CortisolCytokinesModel &model;
+            Statistics *statistics;
+
+            void operator()(const ImplicitState &x, ImplicitState &dxdt, double T) const;
+        };
+
+        struct ImplicitJacobianSystem {
+            CortisolCytokinesModel::JacobianFunction jacobian;
+            Statistics *statistics;
+
+            void operator()(const ImplicitState &x, ImplicitJacobian &J, double T, ImplicitState &dfdt) const;
+        };
+
+        // odeint's error checker, which is what decides whether a step of the explicit steppers is accepted,
+        // reporting each decision
+        template<class Value, class Algebra, class Operations>
+        class CountingErrorChecker : public boost::numeric::odeint::default_error_checker<Value, Algebra, Operations> {
+            private:
+                using Base = boost::numeric::odeint::default_error_checker<Value, Algebra, Operations>;
+
+                Statistics *statistics;
+
+            public:
+                CountingErrorChecker(Value absolute_tolerance, Value relative_tolerance, Statistics *statistics) : Base(absolute_tolerance, relative_tolerance) {
+                    this->statistics = statistics;
+                }
+
+                template<class State, class Deriv, class Err, class Time>
+                inline Value error(Algebra &algebra, const State &x_old, const Deriv &dxdt_old, Err &x_err, Time dt) const {
+                    const Value error = Base::error(algebra, x_old, dxdt_old, x_err, dt);
+
+                    if (this->statistics != nullptr) {
+                        // the controller rejects the step above 1
+                        this->statistics->recordStep(dt, !(error > 1));
+                    }
+
+                    return error;
+                }
+        };
+
+        // rosenbrock4 has it's own controller, which reports whether each step it tried was accepted
+        template<class Stepper>
+        class CountingRosenbrockController : public boost::numeric::odeint::rosenbrock4_controller<Stepper> {
+            private:
+                using Base = boost::numeric::odeint::rosenbrock4_controller<Stepper>;
+
+                Statistics *statistics;
+
+            public:
+                CountingRosenbrockController(double absolute_tolerance, double relative_tolerance, Statistics *statistics) : Base(absolute_tolerance, relative_tolerance) {
+                    this->statistics = statistics;
+                }
+
+                template<class System>
+                inline boost::numeric::odeint::controlled_step_result try_step(System system, ImplicitState &x, double &t, double &dt) {
+                    const double attempted_step = dt;
+                    const auto result = Base::try_step(system, x, t, dt);
+
+                    if (this->statistics != nullptr) {
+                        this->statistics->recordStep(attempted_step, result == boost::numeric::odeint::success);
+                    }
+
+                    return result;
+                }
+
+                template<class System>
+                inline boost::numeric::odeint::controlled_step_result try_step(System system, const ImplicitState &x, double &t, ImplicitState &xout, double &dt) {
+                    const double attempted_step = dt;
+                    const auto result = Base::try_step(system, x, t, xout, dt);
+
+                    if (this->statistics != nullptr) {
+                        this->statistics->recordStep(attempted_step, result == boost::numeric::odeint::success);
+                    }
+
+                    return result;
+                }
+        };
+
+        // what odeint's make_controlled builds, with the counting error checker in place of the default one
+        template<class Stepper>
+        inline auto controlled(Stepper stepper) const {
+            using Checker = CountingErrorChecker<typename Stepper::value_type, typename Stepper::algebra_type, typename Stepper::operations_type>;
+            using Adjuster = boost::numeric::odeint::default_step_adjuster<typename Stepper::value_type, typename Stepper::time_type>;
+
+            return boost::numeric::odeint::controlled_runge_kutta<Stepper, Checker, Adjuster>(Checker(absolute_tolerance, relative_tolerance, this->statistics), Adjuster(), stepper);
+        }
+
+        // observes every step, or only the multiples of the output interval if there's one, so that integrations
+        // continuing one another observe the same points a single integration would, either way the state ends
+        // on end_time, which is only observed when it's one of them
+        // next_step receives the step the dense output steppers would take next, the other steppers don't expose
+        // it, so they start over from initial_step
+        template<class Stepper, class System, class State, class Observer>
+        inline std::size_t run(Stepper stepper, System system, State &state, double start_time, double end_time, Observer observer, double *next_step) const {
+            namespace odeint = boost::numeric::odeint;
+
+            if (next_step != nullptr) {
+                *next_step = this->initial_step;
+            }
+
+            if (this->output_interval > 0) {
+                const auto outputTime = [output_interval = this->output_interval](std::size_t i) {
+                    return double(i) * output_interval;
+                };
+
+                // the output points from start_time to end_time, the divisions may round either way
+                std::size_t first_output = std::size_t(std::ceil(start_time / this->output_interval));
+                std::size_t end_output = std::size_t(std::floor(end_time / this->output_interval)) + 1;
+
+                while (first_output > 0 && outputTime(first_output - 1) >= start_time) {
+                    first_output--;
+                }
+
+                while (outputTime(first_output) < start_time) {
+                    first_output++;
+                }
+
+                while (end_output > first_output && outputTime(end_output - 1) > end_time) {
+                    end_output--;
+                }
+
+                while (outputTime(end_output) <= end_time) {
+                    end_output++;
+                }
+
+                // integrate_const would also take the output interval as the size of the first step, which is
+                // large enough to push the il-6 starting at 0 into negative values where the hill terms are nan
+                // so the output points are passed explicitly, leaving the first step to be initial_step
+                // the ends are added before and after them when they aren't output points themselves
+                const bool observe_start = first_output < end_output && outputTime(first_output) == start_time;
+                const bool observe_end = first_output < end_output && outputTime(end_output - 1) == end_time;
+                const std::size_t time_count = end_output - first_output + !observe_start + !observe_end;
+
+                const auto times = std::views::iota(std::size_t(0), time_count) | std::views::transform([&](std::size_t i) {
+                    if (i == 0 && !observe_start) {
+                        return start_time;
+                    }
+
+                    if (i == time_count - 1 && !observe_end) {
+                        return end_time;
+                    }
+
+                    return outputTime(first_output + i - !observe_start);
+                });
+
+                std::size_t time_index = 0;
+
+                auto output_observer = [&](const State &x, double T) {
+                    const std::size_t i = time_index++;
+
+                    if ((i == 0 && !observe_start) || (i == time_count - 1 && !observe_end)) {
+                        return;
+                    }
+
+                    observer(x, T);
+                };
+
+                if constexpr (std::is_same_v<typename Stepper::stepper_category, odeint::dense_output_stepper_tag>) {
+                    // passed by reference to read the step size it ended with
+                    const std::size_t steps = odeint::integrate_times(std::ref(stepper), system, state, times.begin(), times.end(), this->initial_step, output_observer);
+
+                    if (next_step != nullptr) {
+                        *next_step = stepper.current_time_step();
+                    }
+
+                    return steps;
+                }
+
+                return odeint::integrate_times(stepper, system, state, times.begin(), times.end(), this->initial_step, output_observer);
+            }
+
+            return odeint::integrate_adaptive(stepper, system, state, start_time, end_time, this->initial_step, observer);
+        }
+
+    public:
+        CortisolCytokinesIntegrator(Solver solver = Solver::Dopri5, double absolute_tolerance = ABSOLUTE_TOLERANCE, double relative_tolerance = RELATIVE_TOLERANCE, double output_interval = 0);
+        // reads the optional "solver" object of a configuration file, settings missing from it are left unchanged
+        // throws nlohmann::json::exception for mistyped attributes and std::invalid_argument for invalid settings
+        void parseSettings(const nlohmann::basic_json<> &json_file);
+        void applyOverrides(const Overrides &overrides);
+        void setSolver(Solver solver);
+        void setAbsoluteTolerance(double absolute_tolerance);
+        void setRelativeTolerance(double relative_tolerance);
+        void setOutputInterval(double output_interval);
+        // size of the first step attempted, the steppers adapt it from there
+        void setInitialStep(double initial_step);
+        // every integration from then on adds to statistics, pass nullptr to stop counting
+        // copies of the integrator share it, so they can't integrate concurrently while it's attached
+        void setStatistics(Statistics *statistics);
+        Solver getSolver() const;
+        double getOutputInterval() const;
+
+        // integrates state from start_time to end_time in place, returns the number of steps taken
+        // next_step receives the step size to continue from end_time with when given, which can be passed to
+        // setInitialStep, only the dense output steppers used with an output interval keep it, for the others
+        // it's initial_step
+        template<class Observer = boost::numeric::odeint::null_observer>
+        inline std::size_t integrate(const CortisolCytokinesModel &model, CortisolCytokinesModel::State &state, double start_time, double end_time, Observer observer = Observer(), double *next_step = nullptr) const {
+            namespace odeint = boost::numeric::odeint;
+
+            using State = CortisolCytokinesModel::State;
+            using RosenbrockController = CountingRosenbrockController<odeint::rosenbrock4<double>>;
+
+            const CountedSystem system{model, this->statistics};
+
+            switch (this->solver) {
+                case Solver::CashKarp54:
+                    // without dense output the steps are shortened to land on each output point
+                    return run(controlled(odeint::runge_kutta_cash_karp54<State>()), system, state, start_time, end_time, observer, next_step);
+                case Solver::Rosenbrock4: {
+                    ImplicitState implicit_state(state.size());
+                    std::copy(state.begin(), state.end(), implicit_state.begin());
+
+                    auto implicit_system = std::make_pair(ImplicitSystem{model, this->statistics}, ImplicitJacobianSystem{model.getJacobianFunction(), this->statistics});
+                    auto implicit_observer = [&observer](const ImplicitState &x, double T) {
+                        State observed_state;
+                        std::copy(x.begin(), x.end(), observed_state.begin());
+
+                        observer(observed_state, T);
+                    };
+
+                    std::size_t steps;
+
+                    if (this->output_interval > 0) {
+                        steps = run(odeint::rosenbrock4_dense_output<RosenbrockController>(RosenbrockController(absolute_tolerance, relative_tolerance, this->statistics)), implicit_system, implicit_state, start_time, end_time, implicit_observer, next_step);
+                    } else {
+                        steps = run(RosenbrockController(absolute_tolerance, relative_tolerance, this->statistics), implicit_system, implicit_state, start_time, end_time, implicit_observer, next_step);
+                    }
+
+                    std::copy(implicit_state.begin(), implicit_state.end(), state.begin());
+
+                    return steps;
+                }
+                default:
+                    if (this->output_interval > 0) {
+                        // the dense output stepper interpolates the state at each output point from the steps around it,
+                        // so the points being observed have no influence on which steps are taken
+                        auto controller = controlled(odeint::runge_kutta_dopri5<State>());
+
+                        return run(odeint::dense_output_runge_kutta<decltype(controller)>(controller), system, state, start_time, end_time, observer, next_step);
+                    }
+
+                    return run(controlled(odeint::runge_kutta_dopri5<State>()), system, state, start_time, end_time, observer, next_step);
+            }
+        }
+
+        // integrates one period at a time, comparing the state at the start of each of them (a poincaré section)
+        // once two consecutive sections differ by less than tolerance, relative to the size of each variable with
+        // 1 as the floor, the system has settled into it's cycle and the samples of the last period are replayed
+        // shifted in time until end_time instead of being integrated
+        // the replayed samples land on the output points only when the period is a multiple of the output
+        // interval, otherwise the integration simply continues once the cycle is reached
+        // returns the time at which the cycle was reached, or end_time if it never was
+        // next_step is the same as in integrate
+        template<class Observer = boost::numeric::odeint::null_observer>
+        inline double integratePeriodic(const CortisolCytokinesModel &model, CortisolCytokinesModel::State &state, double start_time, double end_time, double period, double tolerance, Observer observer = Observer(), double *next_step = nullptr) const {
+            CycleSearch search;
+            search.origin = start_time;
+            search.section = state;
+
+            return continuePeriodic(model, state, start_time, end_time, period, tolerance, search, observer, next_step);
+        }
+
+        // integratePeriodic from start_time to end_time continuing search, which started at or before start_time
+        // and left off there, so that an integration split in several gives the same result as a single one
+        // anything at start_time is taken as observed by the integration before this one once search has begun
+        template<class Observer = boost::numeric::odeint::null_observer>
+        inline double continuePeriodic(const CortisolCytokinesModel &model, CortisolCytokinesModel::State &state, double start_time, double end_time, double period, double tolerance, CycleSearch &search, Observer observer = Observer(), double *next_step = nullptr) const {
+            using State = CortisolCytokinesModel::State;
+
+            // how far apart two times can be and still be taken as the same
+            const double time_tolerance = 1e-9 * period;
+            const double output_periods = this->output_interval > 0 ? period / this->output_interval : 0;
+            const bool replayable = this->output_interval == 0 || (std::round(output_periods) >= 1 && std::fabs(output_periods - std::round(output_periods)) <= 1e-9 * output_periods);
+
+            double time = start_time;
+            double last_observed_time = start_time > search.origin ? start_time : -std::numeric_limits<double>::infinity();
+            // every period continues with the step size the one before it ended with
+            CortisolCytokinesIntegrator period_integrator = *this;
+            double step = this->initial_step;
+
+            // the start of every integration after the first was already observed as the end of the one before it,
+            // if it was observed at all
+            const auto observe = [&](const State &x, double T) {
+                if (T <= last_observed_time) {
+                    return;
+                }
+
+                last_observed_time = T;
+
+                if (!search.reached) {
+                    search.cycle.emplace_back(x, T);
+                }
+
+                observer(x, T);
+            };
+
+            while (!search.reached && time < end_time) {
+                const double period_end = search.origin + double(search.periods + 1) * period;
+                double segment_end = end_time;
+                bool period_ended = false;
+
+                if (period_end < end_time - time_tolerance) {
+                    segment_end = period_end;
+                    period_ended = true;
+                } else if (period_end <= end_time + time_tolerance) {
+                    period_ended = true;
+                }
+
+                period_integrator.setInitialStep(step);
+                period_integrator.integrate(model, state, time, segment_end, observe, &step);
+                time = segment_end;
+
+                if (!period_ended) {
+                    break;
+                }
+
+                bool reached = true;
+
+                for (std::size_t i = 0; i < state.size(); i++) {
+                    reached = reached && std::fabs(state[i] - search.section[i]) <= tolerance * std::max(1.0, std::fabs(state[i]));
+                }
+
+                if (reached) {
+                    search.reached = true;
+                    search.cycle_time = time;
+                } else {
+                    search.section = state;
+                    search.periods++;
+                    search.cycle.clear();
+                }
+            }
+
+            const bool replaying = search.reached && replayable && !search.cycle.empty();
+
+            if (replaying && time < end_time) {
+                // the first repetition that can still have samples after time, one early against rounding
+                const double elapsed_periods = std::floor((time - search.cycle_time) / period);
+                bool repeating = true;
+
+                for (std::size_t repetition = std::max<std::size_t>(1, std::size_t(std::max(0.0, elapsed_periods))); repeating; repetition++) {
+                    for (const auto &[x, T] : search.cycle) {
+                        double shifted_time = T + double(repetition) * period;
+
+                        // on the very same output points an integration would have observed
+                        if (this->output_interval > 0) {
+                            shifted_time = std::round(shifted_time / this->output_interval) * this->output_interval;
+                        } else if (std::fabs(shifted_time - end_time) <= time_tolerance) {
+                            shifted_time = end_time;
+                        }
+
+                        if (shifted_time <= time) {
+                            continue;
+                        }
+
+                        if (shifted_time > end_time) {
+                            repeating = false;
+
+                            break;
+                        }
+
+                        state = x;
+                        time = shifted_time;
+                        observer(x, shifted_time);
+                    }
+                }
+            }
+
+            // the rest of the way after the last replayed sample, or all of it if the cycle can't be replayed
+            if (time < end_time) {
+                period_integrator.setInitialStep(step);
+
+                if (replaying) {
+                    period_integrator.integrate(model, state, time, end_time, boost::numeric::odeint::null_observer(), &step);
+                } else {
+                    period_integrator.integrate(model, state, time, end_time, observe, &step);
+                }
+            }
+
+            if (next_step != nullptr) {
+                *next_step = step;
+            }
+
+            return search.reached ? search.cycle_time : end_time;
+        }
+
+        // classic runge kutta with a fixed step size, for systems where every step has to be the same
+        // such as CortisolCytokinesBatchModel, where all the parameter sets advance in lockstep
+        template<class System, class State, class Observer = boost::numeric::odeint::null_observer>
+        static inline std::size_t integrateFixed(const System &system, State &state, double start_time, double end_time, double step_size, Observer observer = Observer()) {
+            return boost::numeric::odeint::integrate_const(boost::numeric::odeint::runge_kutta4<State>(), system, state, start_time, end_time, step_size, observer);
+        }
+};
+
+#endif
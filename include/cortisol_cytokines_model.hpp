@@ -1,7 +1,10 @@
 #ifndef __CORTISOL_CYTOKINES_MODEL_HPP__
 #define __CORTISOL_CYTOKINES_MODEL_HPP__
 
+#include <array>
+#include <memory>
 #include <nlohmann/json.hpp>
+#include <string_view>
 #include <vector>
 
 #include "cortisol_cytokines_values.hpp"
@@ -9,25 +12,89 @@
 
 class CortisolCytokinesModel {
     private:
-        // boost's odeint integration function constantly destroys and recreates the object,
-        // as such, storing the parameters as class members will frequently cause them to be
-        // removed and added to memory
-        // while this isn't an issue for most members the glucose parameter being a map causes
-        // it to reinsert and re-sort the binary tree it uses for it's iternal structure 100s of
+        // boost's odeint integration function constantly copies the object, as such, storing the
+        // parameters as class members would copy all of them (including the glucose curve) 100s of
         // times for each day of the simulation causing a huge processing overhead
-        // to prevent this we store them on a separate class that is statically defined inline
-        // and thus isn't removed from memory
-        static inline CortisolCytokinesValues values = CortisolCytokinesValues();
-
-        static inline Utilities::GetClosestValue<double> get_closest_value = Utilities::GetClosestValue<double>();
+        // to prevent this every copy points to the same immutable block of parameters, which also
+        // lets models in different threads share it without synchronization
+        // setting new parameters replaces the block instead of modifying it, so other models using
+        // the previous one are never affected
+        std::shared_ptr<const CortisolCytokinesValues> values;
 
     public:
-        inline CortisolCytokinesModel(){};
+        // the size of the state is known at compile time, so it's kept on the stack instead of in a vector
+        // which lets odeint's steppers avoid allocating their intermediate states and the compiler unroll
+        // the algebra over it
+        using State = std::array<double, 8>;
+        // row i holds the partial derivatives of dxdt[i] with respect to each state variable
+        using Jacobian = std::array<State, 8>;
+
+        class JacobianFunction;
+
+        // the glucose curve repeats every day, which is the only explicit dependency on time of the equations
+        static constexpr double PERIOD = 1;
+        static constexpr State DEFAULT_INITIAL_CONDITIONS = {2, 5, 10, 0.7, 0, 0, 0.17, 2.32};
+        // configuration file names of each of the state variables, in the order they're stored in
+        static constexpr std::array<std::string_view, 8> STATE_NAMES = {"antigens", "active_macrophages", "resting_macrophages", "il-10", "il-6", "il-8", "tnf-alpha", "cortisol"};
+
+        // throws nlohmann::json::out_of_range if any of them is missing
+        static State readInitialConditions(const nlohmann::basic_json<> &json_file);
+
+        CortisolCytokinesModel();
+        explicit CortisolCytokinesModel(std::shared_ptr<const CortisolCytokinesValues> values);
+        // same exceptions as CortisolCytokinesValues::parseValues
         void setParameters(const nlohmann::basic_json<> &json_file);
         void setDefaultParameters();
-        void operator()(const std::vector<double> &x, std::vector<double> &dxdt, const double T) const;
-        static void plotResults(const std::vector<std::vector<double>> &states, const std::vector<double> &times);
-        static void plotDailyAverage(const std::vector<std::vector<double>> &states, const std::vector<double> &times);
+        void setValues(std::shared_ptr<const CortisolCytokinesValues> values);
+        const CortisolCytokinesValues &getValues() const;
+        void operator()(const State &x, State &dxdt, const double T) const;
+        // analytic jacobian of operator(), dfdt is the partial derivative of dxdt with respect to time
+        void jacobian(const State &x, Jacobian &J, const double T, State &dfdt) const;
+        // jacobian as it's own callable, odeint's implicit steppers take it paired with the model
+        JacobianFunction getJacobianFunction() const;
+
+    private:
+        // the hill functions of the model at a state, evaluated once and shared by the right hand side and
+        // the jacobian, which also needs the powers of the state variables inside them
+        struct HillTerms {
+            double tnf_h_mtnf;
+            double il10_h_m10;
+            double il6_h_106;
+            double tnf_h_6tnf;
+            double il6_h_66;
+            double il10_n_610;
+            double tnf_h_8tnf;
+            double il10_h_810;
+            double il6_h_tnf6;
+            double il10_h_tnf10;
+
+            // activation of macrophages by tnf-alpha and it's inhibition by il-10
+            double mtnf;
+            double m10;
+            // activation of il-10 by il-6
+            double il10_il6;
+            // activation of il-6 by tnf-alpha, and it's inhibition by il-6 and il-10
+            double il6_tnf;
+            double il6_il6;
+            double il6_il10;
+            // activation of il-8 by tnf-alpha
+            double il8_tnf;
+            // inhibition of tnf-alpha by il-6 and il-10
+            double tnf_il6;
+            double tnf_il10;
+        };
+
+        HillTerms hillTerms(const State &x) const;
+};
+
+class CortisolCytokinesModel::JacobianFunction {
+    private:
+        // copies of the model share it's parameter block, so this is as cheap to copy as the model
+        CortisolCytokinesModel model;
+
+    public:
+        explicit JacobianFunction(const CortisolCytokinesModel &model);
+        void operator()(const State &x, Jacobian &J, const double T, State &dfdt) const;
 };
 
 #endif
@@ -0,0 +1,24 @@
+#ifndef __CORTISOL_CYTOKINES_PLOTS_HPP__
+#define __CORTISOL_CYTOKINES_PLOTS_HPP__
+
+#include <future>
+#include <vector>
+
+#include "daily_statistics.hpp"
+#include "thread_pool.hpp"
+#include "trajectory.hpp"
+
+// the figures of a simulation, rendered with matplot++ into output/
+// built as the immuno-endocrine-plotting library, so that the engine itself doesn't depend on matplot++
+class CortisolCytokinesPlots {
+    public:
+        // every figure is rendered as it's own job of the pool, each with it's own gnuplot process
+        // the trajectory has to outlive the returned futures
+        static std::vector<std::future<void>> plotResults(const Trajectory &trajectory, Utilities::ThreadPool &pool);
+        // the statistics have to outlive the returned futures
+        static std::vector<std::future<void>> plotDailyAverage(const Utilities::DailyStatistics &daily_statistics, Utilities::ThreadPool &pool);
+        // both of the above, matches CortisolCytokinesSimulation::Plotter
+        static std::vector<std::future<void>> plotSimulation(const Trajectory &trajectory, const Utilities::DailyStatistics &daily_statistics, Utilities::ThreadPool &pool);
+};
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef __CORTISOL_CYTOKINES_SERVER_HPP__
+#define __CORTISOL_CYTOKINES_SERVER_HPP__
+
+#include <cstddef>
+#include <filesystem>
+#include <istream>
+#include <optional>
+#include <ostream>
+
+#include "cortisol_cytokines_integrator.hpp"
+
+// long running process that reads simulation jobs as lines of json and answers each of them with a line of
+// json once it's done, so that many short runs pay for starting the program and reading the configuration once
+// the jobs run in parallel and are answered in the order they finish, nothing is read from or written to disk
+// besides the configuration file
+// every job is an object that may contain:
+//  "id": any value, echoed back with the results so that they can be matched to the job
+//  "days": days to integrate, the ones given on the command line by default
+//  "parameters": object mapping parameter names to the value they take in this job
+//  "initial_conditions": object mapping state variables to their initial value in this job
+//  "solver": same as in a configuration file
+//  "steady_state": same as in a sweep file
+//  "trajectory": whether to include every sample, false by default
+//  "daily_statistics": whether to include the statistics of each day, false by default
+// and is answered with "id" and "final_state", "trajectory" and "daily_statistics" when they were asked for,
+// and "cycle_reached" with a steady state tolerance, the day the cycle was reached or null if it never was, or
+// with "id" and "error" if the job couldn't be run
+// the integrator overrides and steady state tolerance given to it replace the settings of the configuration
+// and of every job
+class CortisolCytokinesServer {
+    private:
+        // the configuration every job starts from, default parameters without one
+        std::filesystem::path input_path;
+        int days;
+        std::size_t thread_count;
+        CortisolCytokinesIntegrator::Overrides integrator_overrides;
+        std::optional<double> steady_state_tolerance;
+
+    public:
+        CortisolCytokinesServer(std::filesystem::path input_path = std::filesystem::path(), int days = 36500, std::size_t thread_count = 0, CortisolCytokinesIntegrator::Overrides integrator_overrides = {}, std::optional<double> steady_state_tolerance = std::nullopt);
+        void setInputPath(std::filesystem::path input_path);
+        void setDays(int days);
+        void setThreadCount(std::size_t thread_count);
+        void setIntegratorOverrides(CortisolCytokinesIntegrator::Overrides integrator_overrides);
+        void setSteadyStateTolerance(double steady_state_tolerance);
+        // returns once input ends and every job read from it has been answered, the base configuration throws
+        // the same exceptions as CortisolCytokinesConfiguration::readFile, errors of jobs are answered instead
+        void startServer(std::istream &input, std::ostream &output) const;
+};
+
+#endif
@@ -3,21 +3,99 @@
 
 // #include "simulation.hpp"
 
+#include <cstddef>
 #include <filesystem>
+#include <functional>
+#include <future>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "cortisol_cytokines_configuration.hpp"
+#include "cortisol_cytokines_integrator.hpp"
+#include "cortisol_cytokines_model.hpp"
+#include "daily_statistics.hpp"
+#include "metrics.hpp"
+#include "thread_pool.hpp"
+#include "trajectory.hpp"
+#include "utilities.hpp"
 
 class CortisolCytokinesSimulation {
+    public:
+        // renders the figures of a run as jobs of the pool, the trajectory and statistics outlive the futures
+        // CortisolCytokinesPlots::plotSimulation from the immuno-endocrine-plotting library is one
+        using Plotter = std::function<std::vector<std::future<void>>(const Trajectory &trajectory, const Utilities::DailyStatistics &daily_statistics, Utilities::ThreadPool &pool)>;
+
     private:
         int days;
         std::filesystem::path input_path;
+        // takes the place of the input file when set, so that it isn't read again for every run
+        std::optional<CortisolCytokinesConfiguration> configuration;
         bool plot;
+        // plotting is skipped without one
+        Plotter plotter;
         bool csv;
+        // streaming writes samples to disk during the integration instead of storing them
+        bool stream = false;
+        // writes the columnar binary format of Utilities::BinarySink instead of CSV
+        bool binary = false;
+        Utilities::BinarySink::Precision binary_precision = Utilities::BinarySink::Precision::Double;
+        std::size_t block_size = 16384;
+        // significant digits of the CSV values, the shortest text that reads back to the same value when unset
+        std::optional<int> csv_precision;
+        // gzips the CSV output, see Utilities::openOutputStream
+        bool compress = false;
+        // writes the statistics of each day to output/daily.csv, see Utilities::DailyStatistics
+        // a resumed run only has the days after the checkpoint
+        bool daily_statistics = false;
+        // override the "solver" settings of the input file
+        CortisolCytokinesIntegrator::Overrides integrator_overrides;
+        // stops integrating once the daily cycle is reached when set, see CortisolCytokinesIntegrator::integratePeriodic
+        std::optional<double> steady_state_tolerance;
+        // streamed runs write a checkpoint every checkpoint_interval days when there's a path
+        std::filesystem::path checkpoint_path;
+        double checkpoint_interval = 365;
+        // continues from the checkpoint, appending to the output it left behind
+        bool resume = false;
+        // writes the solver statistics, phase durations and peak memory of the run as json when there's a path
+        std::filesystem::path metrics_path;
+
+        // next_step is the same as in CortisolCytokinesIntegrator::integrate
+        // cycle_search continues the steady state search of the integration that ended at start_time when given,
+        // otherwise it starts at start_time and whether the cycle was reached is printed at the end
+        template<class Observer>
+        void integrate(const CortisolCytokinesModel &cortisol_cytokines_model, const CortisolCytokinesIntegrator &integrator, CortisolCytokinesModel::State &state, double start_time, double end_time, Observer observer, double *next_step = nullptr, CortisolCytokinesIntegrator::CycleSearch *cycle_search = nullptr) const;
+
+        void writeDailyStatistics(const Utilities::DailyStatistics &daily_statistics, const std::vector<std::string> &header) const;
+        void writeMetrics(Utilities::Metrics &metrics, const CortisolCytokinesIntegrator &integrator, const CortisolCytokinesIntegrator::Statistics &solver_statistics) const;
+        void streamSimulation(const CortisolCytokinesModel &cortisol_cytokines_model, CortisolCytokinesIntegrator integrator, CortisolCytokinesModel::State initial_conditions, const std::vector<std::string> &header, Utilities::Metrics &metrics) const;
 
     public:
         CortisolCytokinesSimulation(std::filesystem::path input_path = std::filesystem::path(), int days = 36500, bool plot = true, bool csv = true);
         void setDays(int days);
         void setInputPath(std::filesystem::path input_path);
+        void setConfiguration(CortisolCytokinesConfiguration configuration);
         void setPlot(bool plot);
+        void setPlotter(Plotter plotter);
         void setCsv(bool csv);
+        void setStream(bool stream);
+        void setBinary(bool binary);
+        void setBinaryPrecision(Utilities::BinarySink::Precision binary_precision);
+        void setBlockSize(std::size_t block_size);
+        void setCsvPrecision(int csv_precision);
+        void setCompress(bool compress);
+        void setDailyStatistics(bool daily_statistics);
+        void setIntegratorOverrides(CortisolCytokinesIntegrator::Overrides integrator_overrides);
+        void setSolver(CortisolCytokinesIntegrator::Solver solver);
+        void setAbsoluteTolerance(double absolute_tolerance);
+        void setRelativeTolerance(double relative_tolerance);
+        void setOutputInterval(double output_interval);
+        void setSteadyStateTolerance(double steady_state_tolerance);
+        void setCheckpointPath(std::filesystem::path checkpoint_path);
+        void setCheckpointInterval(double checkpoint_interval);
+        void setResume(bool resume);
+        void setMetricsPath(std::filesystem::path metrics_path);
+        // the input file throws the same exceptions as CortisolCytokinesConfiguration::readFile
         void startSimulation() const;
 };
 
@@ -0,0 +1,45 @@
+#ifndef __CORTISOL_CYTOKINES_SWEEP_HPP__
+#define __CORTISOL_CYTOKINES_SWEEP_HPP__
+
+#include <cstddef>
+#include <filesystem>
+#include <optional>
+
+#include "cortisol_cytokines_integrator.hpp"
+
+// runs many variations of one configuration in parallel and writes a summary of each of them
+// the sweep file may contain:
+//  "base": configuration file used as the starting point, relative to the sweep file, default parameters otherwise
+//  "scenarios": list of objects mapping parameter names to the value they take in that scenario
+//  "grid": object mapping parameter names to lists of values, every combination of them is applied to every scenario
+//  "output": path of the summary CSV, output/sweep.csv by default
+//  "step_size": integrates with this fixed step size instead of an adaptive one, which allows the scenarios
+//               to be integrated BATCH_SIZE at a time with vectorized arithmetic
+//  "solver": same as in a configuration file, ignored when integrating with a fixed step size
+//  "steady_state": tolerance at which each scenario stops being integrated once it reaches it's daily cycle,
+//                  which is repeated for the rest of the days, also ignored with a fixed step size
+// the integrator overrides and steady state tolerance given to it replace the settings of both files
+class CortisolCytokinesSweep {
+    public:
+        // 8 doubles fill an AVX-512 register or two AVX2 ones
+        static constexpr std::size_t BATCH_SIZE = 8;
+
+    private:
+        std::filesystem::path sweep_path;
+        int days;
+        std::size_t thread_count;
+        CortisolCytokinesIntegrator::Overrides integrator_overrides;
+        std::optional<double> steady_state_tolerance;
+
+    public:
+        CortisolCytokinesSweep(std::filesystem::path sweep_path, int days = 36500, std::size_t thread_count = 0, CortisolCytokinesIntegrator::Overrides integrator_overrides = {}, std::optional<double> steady_state_tolerance = std::nullopt);
+        void setDays(int days);
+        void setThreadCount(std::size_t thread_count);
+        void setIntegratorOverrides(CortisolCytokinesIntegrator::Overrides integrator_overrides);
+        void setSteadyStateTolerance(double steady_state_tolerance);
+        // throws CortisolCytokinesConfiguration::FileError for files that can't be read, nlohmann::json::exception
+        // for missing or mistyped attributes and std::logic_error for invalid settings or parameters
+        void startSweep() const;
+};
+
+#endif
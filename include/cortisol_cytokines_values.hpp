@@ -1,15 +1,37 @@
 #ifndef __CORTISOL_CYTOKINES_VALUES_HPP__
 #define __CORTISOL_CYTOKINES_VALUES_HPP__
 
+#include <array>
+#include <cstddef>
 #include <map>
 #include <nlohmann/json.hpp>
+#include <string_view>
+#include <utility>
+
+#include "utilities.hpp"
 
 class CortisolCytokinesValues {
     public:
-        inline CortisolCytokinesValues(){};
+        inline CortisolCytokinesValues() {
+            updateDerivedValues();
+        };
 
-        void setValues(const nlohmann::basic_json<> &json_file);
+        // reads the "parameters" object of a configuration file, throws nlohmann::json::exception for missing or
+        // mistyped attributes and std::invalid_argument for an unknown glucose interpolation or a glucose point
+        // that isn't a pair
+        void parseValues(const nlohmann::basic_json<> &json_file);
         void setDefaultValues();
+        // access a parameter by the name it has on the configuration file, throws std::out_of_range
+        // for unknown names
+        // setParameter doesn't update the derived values, updateDerivedValues has to be called afterwards
+        void setParameter(std::string_view name, double value);
+        double getParameter(std::string_view name) const;
+        // must be called whenever any of the parameters below is changed directly
+        void updateDerivedValues();
+
+        static constexpr std::size_t PARAMETER_COUNT = 50;
+        // configuration file name of every scalar parameter and the member it's stored in
+        static const std::array<std::pair<std::string_view, double CortisolCytokinesValues::*>, PARAMETER_COUNT> PARAMETERS;
 
         double k_6 = 4.64;
         double k_6m = 0.01;
@@ -64,6 +86,36 @@ class CortisolCytokinesValues {
         double k_mr = 6;
         double k_m = 1.414;
 
+        // parameter only terms of the hill functions, computed by updateDerivedValues so that
+        // the model doesn't have to recompute them on every evaluation
+        double n_106_h_106;
+        double n_610_h_610;
+        double n_66_h_66;
+        double n_6tnf_h_6tnf;
+        double n_tnf6_h_tnf6;
+        double n_810_h_610_over_h_810;
+        double n_8tnf_h_8tnf;
+        double n_m10_h_m10;
+        double n_tnf10_h_tnf10;
+        double n_mtnf_h_mtnf;
+
+        // x^h kernels for the state dependent terms of the hill functions, also set up by updateDerivedValues
+        Utilities::PowerFunction h_106_power;
+        Utilities::PowerFunction h_66_power;
+        Utilities::PowerFunction h_6tnf_power;
+        Utilities::PowerFunction h_tnf6_power;
+        Utilities::PowerFunction h_810_power;
+        Utilities::PowerFunction h_8tnf_power;
+        Utilities::PowerFunction h_m10_power;
+        Utilities::PowerFunction h_tnf10_power;
+        Utilities::PowerFunction h_mtnf_power;
+        // the IL-10 inhibition of IL-6 uses n_610 as it's exponent
+        Utilities::PowerFunction n_610_power;
+
+        // gluc sampled on an uniform grid over the day, see updateDerivedValues
+        Utilities::LookupTable gluc_table;
+
+        Utilities::LookupTable::Interpolation gluc_interpolation = Utilities::LookupTable::Interpolation::Nearest;
         std::map<double, double> gluc = {
             {0.01653410205714112, 41.24050289026066},
             {0.029155409994415665, 43.82924068400321},
@@ -0,0 +1,71 @@
+#ifndef __DAILY_STATISTICS_HPP__
+#define __DAILY_STATISTICS_HPP__
+
+#include <cstddef>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace Utilities {
+    // statistics of every state variable over each day of a trajectory, accumulated as an observer while
+    // the samples arrive so that neither the trajectory nor a second pass over it is needed
+    // the trajectory is taken to be linear between samples, which makes the statistics weighted by time
+    // instead of by the amount of samples the solver happened to take, and a step crossing midnight is
+    // split between both days
+    // odeint copies observers by value, so this should be passed wrapped in std::ref
+    class DailyStatistics {
+        public:
+            enum Statistic {
+                Mean,
+                Minimum,
+                Maximum,
+                // integral over the day, the area under the curve
+                Integral,
+                Variance,
+                STATISTIC_COUNT
+            };
+
+            static constexpr const char *STATISTIC_NAMES[STATISTIC_COUNT] = {"mean", "min", "max", "auc", "variance"};
+
+        private:
+            std::size_t m_state_size;
+            std::vector<double> m_days;
+            // one column per variable and statistic, the statistics of each variable next to each other
+            std::vector<std::vector<double>> m_columns;
+
+            // the day being accumulated
+            bool m_started = false;
+            double m_day = 0;
+            double m_duration = 0;
+            std::vector<double> m_integral;
+            std::vector<double> m_square_integral;
+            std::vector<double> m_minimum;
+            std::vector<double> m_maximum;
+            std::vector<double> m_previous_state;
+            double m_previous_time = 0;
+            // state interpolated at midnight, kept to not allocate it for every sample
+            std::vector<double> m_boundary_state;
+
+            void startDay(double day);
+            void include(std::span<const double> x);
+            void accumulate(std::span<const double> x, double t);
+            void finishDay();
+
+        public:
+            explicit DailyStatistics(std::size_t state_size = 8);
+            void operator()(std::span<const double> x, double t);
+            // adds the day still being accumulated, which may not have been complete
+            void finish();
+
+            // number of finished days
+            std::size_t size() const;
+            // each day is identified by it's start
+            const std::vector<double> &days() const;
+            const std::vector<double> &column(std::size_t variable, Statistic statistic) const;
+            // day column followed by every statistic of every variable, matching header
+            std::vector<std::span<const double>> columns() const;
+            std::vector<std::string> header(const std::vector<std::string> &variable_names) const;
+    };
+}  // namespace Utilities
+
+#endif
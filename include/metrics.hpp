@@ -0,0 +1,39 @@
+#ifndef __METRICS_HPP__
+#define __METRICS_HPP__
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <nlohmann/json.hpp>
+#include <optional>
+#include <string>
+
+namespace Utilities {
+    // collects how long each phase of a run took and whatever else is worth reporting about it, written out as json
+    // timing a phase costs two reads of the clock, so it's always on
+    class Metrics {
+        private:
+            using Clock = std::chrono::steady_clock;
+
+            // keeps the order the entries were added in
+            nlohmann::ordered_json report;
+            nlohmann::ordered_json phases = nlohmann::ordered_json::object();
+            std::map<std::string, Clock::time_point> running_phases;
+
+        public:
+            // a phase can be started and stopped several times, it's durations add up
+            void startPhase(const std::string &name);
+            void stopPhase(const std::string &name);
+            // adds an entry to the report
+            void set(const std::string &key, nlohmann::ordered_json value);
+            // the phases and the peak resident set size are added as "phases" (in seconds) and "peak_rss_bytes"
+            // throws std::runtime_error if the file can't be written
+            void write(const std::filesystem::path &file_path) const;
+
+            // the most memory the process has had resident so far, empty where it can't be queried
+            static std::optional<std::uintmax_t> peakResidentSetSize();
+    };
+}  // namespace Utilities
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef __OUTPUT_STREAM_HPP__
+#define __OUTPUT_STREAM_HPP__
+
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+
+namespace Utilities {
+#ifdef ENABLE_COMPRESSION
+    constexpr bool COMPRESSION_SUPPORTED = true;
+#else
+    constexpr bool COMPRESSION_SUPPORTED = false;
+#endif
+
+    // where the writers put their bytes, either a plain file or a compressed one
+    // every method throws std::runtime_error when the file can't be written
+    class OutputStream {
+        public:
+            virtual ~OutputStream() = default;
+            virtual void write(const char *data, std::size_t size) = 0;
+            // everything written so far reaches the file, and for a compressed file it's left as a complete
+            // archive, so it can be truncated to the size it has now and appended to later
+            virtual void flush() = 0;
+            virtual void close() = 0;
+    };
+
+    // paths ending in .gz are compressed with gzip, which is only available when built with ENABLE_COMPRESSION
+    // throws std::runtime_error if the file can't be opened
+    std::unique_ptr<OutputStream> openOutputStream(const std::filesystem::path &file_path, bool append = false);
+}  // namespace Utilities
+
+#endif
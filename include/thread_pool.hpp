@@ -0,0 +1,55 @@
+#ifndef __THREAD_POOL_HPP__
+#define __THREAD_POOL_HPP__
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace Utilities {
+    // fixed set of worker threads taking jobs from a shared queue
+    // meant for coarse jobs such as whole simulations, where a single queue never becomes contended
+    class ThreadPool {
+        private:
+            std::vector<std::jthread> workers;
+            std::queue<std::move_only_function<void()>> jobs;
+            std::mutex jobs_mutex;
+            std::condition_variable jobs_available;
+            bool stopping = false;
+
+            void work();
+
+        public:
+            // 0 uses one thread per hardware thread
+            explicit ThreadPool(std::size_t thread_count = 0);
+            // finishes every job already submitted before returning
+            ~ThreadPool();
+
+            ThreadPool(const ThreadPool &) = delete;
+            ThreadPool &operator=(const ThreadPool &) = delete;
+
+            std::size_t size() const;
+
+            template<class Function>
+            std::future<std::invoke_result_t<Function>> submit(Function function) {
+                std::packaged_task<std::invoke_result_t<Function>()> task(std::move(function));
+                auto future = task.get_future();
+
+                {
+                    std::scoped_lock lock(jobs_mutex);
+                    jobs.emplace(std::move(task));
+                }
+
+                jobs_available.notify_one();
+
+                return future;
+            }
+    };
+}  // namespace Utilities
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef __TRAJECTORY_HPP__
+#define __TRAJECTORY_HPP__
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+// stores the samples of a simulation as one contiguous column per state variable plus a time column
+// so that every sample doesn't require it's own allocation and each variable can be handed directly
+// to the plotting and writing functions
+class Trajectory {
+    private:
+        std::vector<double> m_times;
+        std::vector<std::vector<double>> m_states;
+
+    public:
+        explicit Trajectory(std::size_t state_size = 8);
+
+        void reserve(std::size_t samples);
+        void clear();
+
+        template<class State>
+        inline void push_back(const State &x, double t) {
+            m_times.push_back(t);
+
+            for (std::size_t i = 0; i < m_states.size(); i++) {
+                m_states[i].push_back(x[i]);
+            }
+        }
+
+        inline std::size_t size() const {
+            return m_times.size();
+        }
+
+        inline std::size_t stateSize() const {
+            return m_states.size();
+        }
+
+        inline bool empty() const {
+            return m_times.empty();
+        }
+
+        inline const std::vector<double> &times() const {
+            return m_times;
+        }
+
+        inline const std::vector<double> &state(std::size_t index) const {
+            return m_states[index];
+        }
+
+        // time column followed by every state column
+        std::vector<std::span<const double>> columns() const;
+};
+
+#endif
@@ -3,92 +3,292 @@
 
 #include <fmt/base.h>
 
+#include <algorithm>
+#include <bit>
 #include <cmath>
+#include <cstddef>
+#include <cstdint>
 #include <filesystem>
+#include <fstream>
+#include <future>
 #include <iterator>
 #include <map>
+#include <memory>
 #include <optional>
+#include <span>
 #include <stdexcept>
+#include <string>
+#include <utility>
 #include <vector>
 
+#include "output_stream.hpp"
+#include "trajectory.hpp"
+
 #ifndef NDEBUG
     #include <chrono>
 #endif
 
 namespace Utilities {
-    std::map<double, std::vector<double>> combineStateWithTimeMap(const std::vector<std::vector<double>> &states, const std::vector<double> &times);
-    std::vector<std::vector<double>> combineStateWithTimeVector(const std::vector<std::vector<double>> &states, const std::vector<double> &times);
+    // samples a curve given by a set of points on an uniform grid so that a lookup is a single index
+    // computation instead of a search over the points
+    class LookupTable {
+        public:
+            enum class Interpolation {
+                // value of the closest point, what the glucose curve has historically used
+                Nearest,
+                Linear,
+                // monotone cubic hermite, doesn't overshoot between the points
+                Cubic
+            };
+
+            static Interpolation parseInterpolation(const std::string &name);
 
-    template<class Type>
-    class GetClosestValue {
         private:
-            std::map<double, Type> map;
-            std::map<double, Type>::iterator last_position;
-            double last_key;
+            std::vector<double> m_values;
+            // the nearest interpolation keeps the original points, every grid cell stores the index of
+            // the last point at or before it's left edge and the lookup walks from there to the closest one
+            std::vector<double> m_keys;
+            std::vector<double> m_points;
+            std::vector<std::size_t> m_cells;
+            double m_start = 0;
+            double m_inverse_step = 0;
+            Interpolation m_interpolation = Interpolation::Nearest;
 
         public:
-            inline void setValues(std::map<double, Type> map) {
-                this->map = map;
-                this->last_position = this->map.begin();
-                this->last_key = 0;
+            LookupTable() = default;
+            // keys outside of the range of the points are clamped to it
+            LookupTable(const std::map<double, double> &points, Interpolation interpolation = Interpolation::Nearest, std::size_t resolution = 4096);
+
+            inline double operator()(double key) const {
+                if (m_interpolation == Interpolation::Nearest) {
+                    const double position = std::clamp((key - m_start) * m_inverse_step, 0.0, double(m_cells.size() - 1));
+                    std::size_t index = m_cells[std::size_t(position)];
+
+                    // ties go to the later point
+                    while (index + 1 < m_keys.size() && !(std::fabs(m_keys[index] - key) < std::fabs(m_keys[index + 1] - key))) {
+                        index++;
+                    }
+
+                    // only taken when rounding put the key in the cell after it's own
+                    while (index > 0 && std::fabs(m_keys[index - 1] - key) < std::fabs(m_keys[index] - key)) {
+                        index--;
+                    }
+
+                    return m_points[index];
+                }
+
+                const double position = std::clamp((key - m_start) * m_inverse_step, 0.0, double(m_values.size() - 1));
+
+                const std::size_t index = std::min(std::size_t(position), m_values.size() - 2);
+                const double fraction = position - double(index);
+
+                return m_values[index] + fraction * (m_values[index + 1] - m_values[index]);
             }
 
-            inline Type find(double key) {
-                typedef typename std::map<double, Type>::iterator MapType;
-
-                if (this->last_key <= key) {
-                    auto previous_loop_position = this->last_position;
-                    auto current_loop_position = std::next(previous_loop_position);
-
-                    while (true) {
-                        if (
-                            (current_loop_position == this->map.end()) ||
-                            (std::fabs(previous_loop_position->first - key) < std::fabs(current_loop_position->first - key))
-                        ) {
-                            this->last_key = key;
-                            this->last_position = previous_loop_position;
-
-                            return previous_loop_position->second;
-                        } else {
-                            previous_loop_position = current_loop_position;
-                            current_loop_position = std::next(current_loop_position);
-                        }
+            // derivative of the table with respect to the key, the nearest interpolation is piecewise constant
+            // so it's 0 there, as it is outside of the range of the points
+            inline double slope(double key) const {
+                const double position = (key - m_start) * m_inverse_step;
+
+                if (m_interpolation == Interpolation::Nearest || position < 0 || position > double(m_values.size() - 1)) {
+                    return 0;
+                }
+
+                const std::size_t index = std::min(std::size_t(position), m_values.size() - 2);
+
+                return (m_values[index + 1] - m_values[index]) * m_inverse_step;
+            }
+    };
+
+    // exp and log made only of arithmetic and bit operations so that loops calling them can be
+    // vectorized by the compiler, which isn't possible with the standard library functions
+    // both are accurate to a couple of ulp, vectorizableLog expects a positive, normal and finite x
+    inline double vectorizableExp(double x) {
+        constexpr double LOG2E = 1.4426950408889634;
+        constexpr double LN2_HIGH = 0.6931471803691238;
+        constexpr double LN2_LOW = 1.9082149292705877e-10;
+        // adding and removing 1.5 * 2^52 rounds to the nearest integer without calling any function
+        constexpr double ROUNDING_CONSTANT = 0x1.8p52;
+
+        const double clamped = (x < -708.0 ? -708.0 : (x > 709.0 ? 709.0 : x));
+        const double shifted = clamped * LOG2E + ROUNDING_CONSTANT;
+        const double k = shifted - ROUNDING_CONSTANT;
+        const double r = (clamped - k * LN2_HIGH) - k * LN2_LOW;
+
+        // taylor series of e^r, |r| <= ln(2) / 2
+        double series = 1.0 / 6227020800.0;
+        series = series * r + 1.0 / 479001600.0;
+        series = series * r + 1.0 / 39916800.0;
+        series = series * r + 1.0 / 3628800.0;
+        series = series * r + 1.0 / 362880.0;
+        series = series * r + 1.0 / 40320.0;
+        series = series * r + 1.0 / 5040.0;
+        series = series * r + 1.0 / 720.0;
+        series = series * r + 1.0 / 120.0;
+        series = series * r + 1.0 / 24.0;
+        series = series * r + 1.0 / 6.0;
+        series = series * r + 0.5;
+        series = series * r + 1.0;
+        series = series * r + 1.0;
+
+        // the low bits of shifted hold k, moving it into the exponent field gives 2^k
+        const std::int64_t k_bits = std::bit_cast<std::int64_t>(shifted) - std::bit_cast<std::int64_t>(ROUNDING_CONSTANT);
+        const double scale = std::bit_cast<double>((k_bits + 1023) << 52);
+
+        const double result = series * scale;
+
+        return x < -708.0 ? 0.0 : (x > 709.0 ? HUGE_VAL : result);
+    }
+
+    inline double vectorizableLog(double x) {
+        constexpr double LN2 = 0.6931471805599453;
+        constexpr double SQRT2 = 1.4142135623730951;
+
+        const std::int64_t bits = std::bit_cast<std::int64_t>(x);
+        // x = m * 2^e with m in [1, 2)
+        // the same magic number trick as vectorizableExp, converting a 64 bit integer directly
+        // isn't vectorizable without AVX-512
+        double exponent = std::bit_cast<double>((bits >> 52) | 0x4330000000000000) - (0x1p52 + 1023);
+        double mantissa = std::bit_cast<double>((bits & 0x000FFFFFFFFFFFFF) | 0x3FF0000000000000);
+
+        // m in [sqrt(2) / 2, sqrt(2)) keeps the series below small
+        const bool large = mantissa > SQRT2;
+        mantissa = large ? mantissa * 0.5 : mantissa;
+        exponent = large ? exponent + 1 : exponent;
+
+        // log(m) = 2 * atanh(f), f = (m - 1) / (m + 1), |f| <= 0.172
+        const double f = (mantissa - 1) / (mantissa + 1);
+        const double f2 = f * f;
+
+        double series = 1.0 / 21.0;
+        series = series * f2 + 1.0 / 19.0;
+        series = series * f2 + 1.0 / 17.0;
+        series = series * f2 + 1.0 / 15.0;
+        series = series * f2 + 1.0 / 13.0;
+        series = series * f2 + 1.0 / 11.0;
+        series = series * f2 + 1.0 / 9.0;
+        series = series * f2 + 1.0 / 7.0;
+        series = series * f2 + 1.0 / 5.0;
+        series = series * f2 + 1.0 / 3.0;
+        series = series * f2 + 1.0;
+
+        return exponent * LN2 + 2 * f * series;
+    }
+
+    // evaluates x^exponent, choosing once at construction the cheapest way of doing so
+    // small integer exponents, which most of the hill coefficients are, become multiplication chains
+    // and only fractional exponents go through std::pow
+    class PowerFunction {
+        private:
+            enum class Kind {
+                Zero,
+                One,
+                Square,
+                Cube,
+                Fourth,
+                Integer,
+                Fractional
+            };
+
+            Kind kind;
+            double exponent;
+            long integer_exponent;
+
+        public:
+            inline PowerFunction(double exponent = 1): exponent(exponent), integer_exponent(0) {
+                // larger integers are left to std::pow since the multiplication chain stops being cheaper
+                // and accumulates more rounding error
+                if (exponent == std::trunc(exponent) && std::fabs(exponent) <= 64) {
+                    integer_exponent = long(exponent);
+
+                    switch (integer_exponent) {
+                        case 0:
+                            kind = Kind::Zero;
+                            break;
+                        case 1:
+                            kind = Kind::One;
+                            break;
+                        case 2:
+                            kind = Kind::Square;
+                            break;
+                        case 3:
+                            kind = Kind::Cube;
+                            break;
+                        case 4:
+                            kind = Kind::Fourth;
+                            break;
+                        default:
+                            kind = Kind::Integer;
+                            break;
                     }
                 } else {
-                    auto previous_loop_position = this->last_position;
-                    auto current_loop_position = std::prev(previous_loop_position);
+                    kind = Kind::Fractional;
+                }
+            }
 
-                    if (
-                        (std::fabs(this->map.begin()->first - key) < std::fabs(previous_loop_position->first - key)) &&
-                        (std::fabs(this->map.begin()->first - key) < std::fabs(current_loop_position->first - key))
-                    ) {
-                        this->last_key = key;
-                        this->last_position = this->map.begin();
+            inline double operator()(double x) const {
+                switch (kind) {
+                    case Kind::Zero:
+                        return 1;
+                    case Kind::One:
+                        return x;
+                    case Kind::Square:
+                        return x * x;
+                    case Kind::Cube:
+                        return x * x * x;
+                    case Kind::Fourth: {
+                        const double square = x * x;
 
-                        return this->map.begin()->second;
+                        return square * square;
                     }
+                    case Kind::Integer: {
+                        // exponentiation by squaring
+                        unsigned long remaining = std::labs(integer_exponent);
+                        double base = x;
+                        double result = 1;
 
-                    while (true) {
-                        if (std::fabs(previous_loop_position->first - key) < std::fabs(current_loop_position->first - key)) {
-                            this->last_key = key;
-                            this->last_position = previous_loop_position;
-
-                            return previous_loop_position->second;
-                        } else if (current_loop_position == this->map.begin()) {
-                            this->last_key = key;
-                            this->last_position = current_loop_position;
+                        while (remaining != 0) {
+                            if (remaining & 1) {
+                                result *= base;
+                            }
 
-                            return current_loop_position->second;
-                        } else {
-                            previous_loop_position = current_loop_position;
-                            current_loop_position = std::prev(current_loop_position);
+                            base *= base;
+                            remaining >>= 1;
                         }
+
+                        return integer_exponent < 0 ? 1 / result : result;
                     }
+                    default:
+                        return std::pow(x, exponent);
+                }
+            }
+
+            // d/dx x^exponent
+            inline double derivative(double x) const {
+                switch (kind) {
+                    case Kind::Zero:
+                        return 0;
+                    case Kind::One:
+                        return 1;
+                    case Kind::Square:
+                        return 2 * x;
+                    case Kind::Cube:
+                        return 3 * x * x;
+                    case Kind::Fourth:
+                        return 4 * x * x * x;
+                    default:
+                        return exponent * std::pow(x, exponent - 1);
                 }
             }
     };
 
-    std::map<double, double> vectorToMap(std::vector<std::vector<double>> vector);
+    // every inner vector is a key and it's value, throws std::invalid_argument otherwise
+    std::map<double, double> vectorToMap(const std::vector<std::vector<double>> &vector);
+
+    // reduces a series with increasing x to the minimum and maximum of each of bucket_count equally wide ranges
+    // of x, in the order they occur, plus the first and last points, so that the series drawn bucket_count pixels
+    // wide looks the same as with every point, spikes included, while the amount of points doesn't depend on it's length
+    std::pair<std::vector<double>, std::vector<double>> decimateMinMax(std::span<const double> x, std::span<const double> y, std::size_t bucket_count);
 
     template<class Type>
     inline std::optional<Type> readParameter(
@@ -120,8 +320,7 @@ namespace Utilities {
 
     class IntegralObserver {
         private:
-            std::vector<std::vector<double>> &m_states;
-            std::vector<double> &m_times;
+            Trajectory &m_trajectory;
 
 #ifndef NDEBUG
             // auto keyword can't be used for class members
@@ -129,11 +328,145 @@ namespace Utilities {
 #endif
 
         public:
-            IntegralObserver(std::vector<std::vector<double>> &states, std::vector<double> &times);
-            void operator()(const std::vector<double> &x, double t);
+            IntegralObserver(Trajectory &trajectory);
+            void operator()(std::span<const double> x, double t);
+    };
+
+    // receives consecutive blocks of a trajectory
+    // sinks opened with append continue an existing file, as when resuming from a checkpoint, and don't
+    // write their header again
+    // every method throws std::runtime_error once the file can't be written
+    class TrajectorySink {
+        public:
+            virtual ~TrajectorySink() = default;
+            virtual void writeBlock(const Trajectory &block) = 0;
+            // writes out everything buffered so far and returns the size of the file in bytes
+            virtual std::uintmax_t flush() = 0;
+            virtual void close() = 0;
+    };
+
+    // formats the values straight into a large buffer that's written out whenever it fills up, so writing
+    // a row neither allocates nor goes through a stream
+    // the values are formatted with std::to_chars, as the shortest text that reads back to the same double
+    // unless a precision (in significant digits) is given
+    // in the background the full buffer is written, and compressed if the path ends in .gz, by another thread
+    // while the next one is being formatted, an error it runs into is thrown by the next writeRows, flush or
+    // close as std::runtime_error
+    // a writer that wasn't closed writes out what it has when it's destroyed, where errors can only be printed
+    class CsvWriter {
+        public:
+            static constexpr std::size_t BUFFER_SIZE = 4 << 20;
+
+        private:
+            std::unique_ptr<OutputStream> output;
+            std::optional<int> precision;
+            std::vector<char> buffer;
+            std::size_t buffer_used = 0;
+            bool background;
+            // buffer being written by the background thread
+            std::vector<char> written_buffer;
+            std::future<void> write;
+            bool closed = false;
+            // set once an error was thrown, nothing is written after it
+            bool failed = false;
+
+            void writeBuffer();
+            // waits for the background write, rethrowing it's error
+            void finishWrite();
+
+        public:
+            // appending continues an existing file without writing the header again
+            CsvWriter(const std::vector<std::string> &header, const std::filesystem::path &file_path, std::optional<int> precision = std::nullopt, bool background = false, bool append = false);
+            ~CsvWriter();
+
+            CsvWriter(const CsvWriter &) = delete;
+            CsvWriter &operator=(const CsvWriter &) = delete;
+
+            // each column is a CSV column, all of them must have the same length
+            void writeRows(const std::vector<std::span<const double>> &columns);
+            // waits for everything written so far to reach the file
+            void flush();
+            void close();
+    };
+
+    class CsvSink : public TrajectorySink {
+        private:
+            std::filesystem::path file_path;
+            CsvWriter writer;
+
+        public:
+            // the file is written in the background while the integration continues
+            CsvSink(const std::vector<std::string> &header, const std::filesystem::path &file_path = "output/values.csv", bool append = false, std::optional<int> precision = std::nullopt);
+            void writeBlock(const Trajectory &block) override;
+            std::uintmax_t flush() override;
+            void close() override;
+    };
+
+    // columnar little endian floats that can be memory mapped and used in place
+    // the header holds the layout, the column names and the total number of samples, followed by one record
+    // batch per written block, which is the number of samples in it and then each column contiguously
+    // so a trajectory written in a single block is a single array per column
+    //     "IECPCOLS", uint32 version, uint32 value size (8 or 4), uint64 column count, uint64 sample count
+    //     per column: uint64 name length, name (utf-8)
+    //     per batch: uint64 sample count, per column: sample count values
+    // the first column, the time, is always float64 and the value size only applies to the others
+    // everything is padded with zeros to a multiple of 8 bytes, so every column is aligned for it's type
+    class BinarySink : public TrajectorySink {
+        public:
+            enum class Precision {
+                Double,
+                // nearly halves the size of the file, the state variables are rounded to float
+                // the time stays a double, float spacing near 36500 days is close to the step size
+                Single
+            };
+
+            // since 2 the time is a double in single precision files too
+            static constexpr std::uint32_t VERSION = 2;
+
+        private:
+            std::filesystem::path file_path;
+            std::fstream file;
+            Precision precision;
+            std::uint64_t sample_count = 0;
+            // every batch is assembled here and written with a single call
+            std::vector<char> buffer;
+
+            template<class Value>
+            void appendColumn(std::span<const double> column);
+            void writeSampleCount();
+            void check() const;
+
+        public:
+            // appending checks that the existing file has the same layout and column names, throws
+            // std::runtime_error otherwise
+            BinarySink(const std::vector<std::string> &header, const std::filesystem::path &file_path = "output/values.bin", bool append = false, Precision precision = Precision::Double);
+            void writeBlock(const Trajectory &block) override;
+            std::uintmax_t flush() override;
+            void close() override;
+    };
+
+    // unlike IntegralObserver this doesn't keep the whole trajectory in memory, samples are
+    // buffered and handed to the sink every block_size samples
+    // odeint copies observers by value, so this should be passed wrapped in std::ref
+    class StreamingObserver {
+        private:
+            TrajectorySink &m_sink;
+            std::size_t m_block_size;
+            Trajectory m_block;
+
+#ifndef NDEBUG
+            double previous_time = 0;
+            std::chrono::time_point<std::chrono::high_resolution_clock, std::chrono::duration<long int, std::ratio<1LL, 1000000000LL>>> previous_decade_time = std::chrono::high_resolution_clock::now();
+#endif
+
+        public:
+            StreamingObserver(TrajectorySink &sink, std::size_t block_size = 16384, std::size_t state_size = 8);
+            void operator()(std::span<const double> x, double t);
+            void flush();
     };
 
-    void writeCsv(const std::vector<std::string> &header, const std::vector<std::vector<double>> &values, const std::filesystem::path &output_path = "output/values.csv");
+    // each column is written as a CSV column, all of them must have the same length
+    void writeCsv(const std::vector<std::string> &header, const std::vector<std::span<const double>> &columns, const std::filesystem::path &output_path = "output/values.csv", std::optional<int> precision = std::nullopt);
 }  // namespace Utilities
 
 #endif
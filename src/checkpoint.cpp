@@ -0,0 +1,165 @@
+#include "checkpoint.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace Utilities {
+    constexpr std::string_view CHECKPOINT_MAGIC = "IECPCKPT";
+
+    namespace {
+        // flushing a stream only hands the data to the operating system, this waits for it to reach the disk
+        void syncFile(const std::filesystem::path &file_path) {
+#ifdef _WIN32
+            const HANDLE file = CreateFileW(file_path.c_str(), GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+            const bool synced = file != INVALID_HANDLE_VALUE && FlushFileBuffers(file);
+
+            if (file != INVALID_HANDLE_VALUE) {
+                CloseHandle(file);
+            }
+#else
+            const int file = open(file_path.c_str(), O_WRONLY);
+            const bool synced = file >= 0 && fsync(file) == 0;
+
+            if (file >= 0) {
+                close(file);
+            }
+#endif
+
+            if (!synced) {
+                throw std::runtime_error("Couldn't sync " + file_path.string());
+            }
+        }
+    }  // namespace
+
+    Checkpoint Checkpoint::read(const std::filesystem::path &file_path) {
+        std::ifstream file(file_path, std::ios::binary);
+
+        if (!file) {
+            throw std::runtime_error("Couldn't open " + file_path.string());
+        }
+
+        std::string magic(CHECKPOINT_MAGIC.size(), '\0');
+        file.read(magic.data(), magic.size());
+
+        if (magic != CHECKPOINT_MAGIC) {
+            throw std::runtime_error(file_path.string() + " isn't a checkpoint");
+        }
+
+        Checkpoint checkpoint;
+        std::uint64_t state_size = 0;
+        std::uint64_t output_size = 0;
+
+        file.read(reinterpret_cast<char *>(&state_size), sizeof(state_size));
+
+        // a corrupted size shouldn't turn into a huge allocation
+        if (!file || state_size > 1024) {
+            throw std::runtime_error("Invalid state size in " + file_path.string());
+        }
+
+        checkpoint.state.resize(state_size);
+        file.read(reinterpret_cast<char *>(checkpoint.state.data()), state_size * sizeof(double));
+        file.read(reinterpret_cast<char *>(&checkpoint.time), sizeof(checkpoint.time));
+        file.read(reinterpret_cast<char *>(&checkpoint.step_size), sizeof(checkpoint.step_size));
+        file.read(reinterpret_cast<char *>(&output_size), sizeof(output_size));
+
+        if (!file) {
+            throw std::runtime_error("Truncated checkpoint " + file_path.string());
+        }
+
+        checkpoint.output_size = output_size;
+
+        if (file.peek() == std::ifstream::traits_type::eof()) {
+            return checkpoint;
+        }
+
+        Checkpoint::CycleSearch &cycle_search = checkpoint.cycle_search.emplace();
+        std::uint64_t periods = 0;
+        std::uint8_t reached = 0;
+        std::uint64_t sample_count = 0;
+
+        cycle_search.section.resize(state_size);
+        file.read(reinterpret_cast<char *>(&cycle_search.origin), sizeof(cycle_search.origin));
+        file.read(reinterpret_cast<char *>(&periods), sizeof(periods));
+        file.read(reinterpret_cast<char *>(cycle_search.section.data()), state_size * sizeof(double));
+        file.read(reinterpret_cast<char *>(&reached), sizeof(reached));
+        file.read(reinterpret_cast<char *>(&cycle_search.cycle_time), sizeof(cycle_search.cycle_time));
+        file.read(reinterpret_cast<char *>(&sample_count), sizeof(sample_count));
+
+        // the samples have to fit in what's left of the file, for the same reason as the state size
+        const std::uint64_t sample_size = (state_size + 1) * sizeof(double);
+        const std::uint64_t remaining_size = file ? std::filesystem::file_size(file_path) - std::uint64_t(file.tellg()) : 0;
+
+        if (!file || sample_count > remaining_size / sample_size) {
+            throw std::runtime_error("Truncated checkpoint " + file_path.string());
+        }
+
+        cycle_search.periods = periods;
+        cycle_search.reached = reached != 0;
+        cycle_search.cycle.resize(sample_count * (state_size + 1));
+        file.read(reinterpret_cast<char *>(cycle_search.cycle.data()), cycle_search.cycle.size() * sizeof(double));
+
+        if (!file) {
+            throw std::runtime_error("Truncated checkpoint " + file_path.string());
+        }
+
+        return checkpoint;
+    }
+
+    void Checkpoint::write(const std::filesystem::path &file_path) const {
+        std::filesystem::path temporary_path = file_path;
+        temporary_path += ".tmp";
+
+        {
+            std::ofstream file(temporary_path, std::ios::binary | std::ios::trunc);
+
+            if (!file) {
+                throw std::runtime_error("Couldn't open " + temporary_path.string());
+            }
+
+            const std::uint64_t state_size = state.size();
+            const std::uint64_t output_size = this->output_size;
+
+            file.write(CHECKPOINT_MAGIC.data(), CHECKPOINT_MAGIC.size());
+            file.write(reinterpret_cast<const char *>(&state_size), sizeof(state_size));
+            file.write(reinterpret_cast<const char *>(state.data()), state.size() * sizeof(double));
+            file.write(reinterpret_cast<const char *>(&time), sizeof(time));
+            file.write(reinterpret_cast<const char *>(&step_size), sizeof(step_size));
+            file.write(reinterpret_cast<const char *>(&output_size), sizeof(output_size));
+
+            if (cycle_search) {
+                const std::uint64_t periods = cycle_search->periods;
+                const std::uint8_t reached = cycle_search->reached;
+                const std::uint64_t sample_count = cycle_search->cycle.size() / (state.size() + 1);
+
+                file.write(reinterpret_cast<const char *>(&cycle_search->origin), sizeof(cycle_search->origin));
+                file.write(reinterpret_cast<const char *>(&periods), sizeof(periods));
+                file.write(reinterpret_cast<const char *>(cycle_search->section.data()), cycle_search->section.size() * sizeof(double));
+                file.write(reinterpret_cast<const char *>(&reached), sizeof(reached));
+                file.write(reinterpret_cast<const char *>(&cycle_search->cycle_time), sizeof(cycle_search->cycle_time));
+                file.write(reinterpret_cast<const char *>(&sample_count), sizeof(sample_count));
+                file.write(reinterpret_cast<const char *>(cycle_search->cycle.data()), cycle_search->cycle.size() * sizeof(double));
+            }
+
+            if (!file.flush()) {
+                throw std::runtime_error("Couldn't write " + temporary_path.string());
+            }
+        }
+
+        // otherwise the rename can reach the disk before the contents do, and a crash in between leaves an
+        // empty or partial file under the checkpoint's name
+        syncFile(temporary_path);
+        std::filesystem::rename(temporary_path, file_path);
+    }
+}  // namespace Utilities
@@ -0,0 +1,135 @@
+#include "cortisol_cytokines_configuration.hpp"
+
+#include <cmath>
+#include <cstddef>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <nlohmann/json.hpp>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "cortisol_cytokines_integrator.hpp"
+#include "cortisol_cytokines_model.hpp"
+#include "cortisol_cytokines_values.hpp"
+
+CortisolCytokinesConfiguration::FileError::FileError(const std::filesystem::path &file_path): std::runtime_error("Error reading from file " + file_path.string() + ".") {}
+
+CortisolCytokinesConfiguration::CortisolCytokinesConfiguration() {
+    auto values = std::make_shared<CortisolCytokinesValues>();
+    values->setDefaultValues();
+
+    this->values = std::move(values);
+}
+
+CortisolCytokinesConfiguration CortisolCytokinesConfiguration::fromJson(const nlohmann::basic_json<> &json_file) {
+    CortisolCytokinesConfiguration configuration;
+    auto values = std::make_shared<CortisolCytokinesValues>();
+
+    values->parseValues(json_file);
+    configuration.setValues(std::move(values));
+    configuration.setInitialConditions(CortisolCytokinesModel::readInitialConditions(json_file));
+    configuration.integrator.parseSettings(json_file);
+
+    return configuration;
+}
+
+CortisolCytokinesConfiguration CortisolCytokinesConfiguration::readFile(const std::filesystem::path &file_path) {
+    return fromJson(readJson(file_path));
+}
+
+nlohmann::json CortisolCytokinesConfiguration::readJson(const std::filesystem::path &file_path) {
+    std::ifstream file_stream(file_path);
+
+    try {
+        return nlohmann::json::parse(file_stream);
+    } catch (const nlohmann::json::parse_error &) {
+        std::throw_with_nested(FileError(file_path));
+    }
+}
+
+void CortisolCytokinesConfiguration::setValues(std::shared_ptr<const CortisolCytokinesValues> values) {
+    validate(*values);
+
+    this->values = std::move(values);
+}
+
+void CortisolCytokinesConfiguration::setInitialConditions(const CortisolCytokinesModel::State &initial_conditions) {
+    validate(initial_conditions);
+
+    this->initial_conditions = initial_conditions;
+}
+
+void CortisolCytokinesConfiguration::setIntegrator(const CortisolCytokinesIntegrator &integrator) {
+    this->integrator = integrator;
+}
+
+void CortisolCytokinesConfiguration::setParameter(std::string_view name, double value) {
+    setParameters({{std::string(name), value}});
+}
+
+void CortisolCytokinesConfiguration::setParameters(const std::map<std::string, double> &parameters) {
+    if (parameters.empty()) {
+        return;
+    }
+
+    // other copies of the configuration may be using the current block
+    auto values = std::make_shared<CortisolCytokinesValues>(*this->values);
+
+    for (const auto &[name, value] : parameters) {
+        values->setParameter(name, value);
+    }
+
+    values->updateDerivedValues();
+    setValues(std::move(values));
+}
+
+double CortisolCytokinesConfiguration::getParameter(std::string_view name) const {
+    return this->values->getParameter(name);
+}
+
+const std::shared_ptr<const CortisolCytokinesValues> &CortisolCytokinesConfiguration::getValues() const {
+    return this->values;
+}
+
+const CortisolCytokinesModel::State &CortisolCytokinesConfiguration::getInitialConditions() const {
+    return this->initial_conditions;
+}
+
+const CortisolCytokinesIntegrator &CortisolCytokinesConfiguration::getIntegrator() const {
+    return this->integrator;
+}
+
+CortisolCytokinesModel CortisolCytokinesConfiguration::getModel() const {
+    return CortisolCytokinesModel(this->values);
+}
+
+void CortisolCytokinesConfiguration::validate(const CortisolCytokinesValues &values) {
+    for (const auto &[name, member] : CortisolCytokinesValues::PARAMETERS) {
+        if (!std::isfinite(values.*member)) {
+            throw std::invalid_argument("The parameter " + std::string(name) + " has to be a finite number");
+        }
+    }
+
+    if (values.gluc.empty()) {
+        throw std::invalid_argument("The glucose curve needs at least one point");
+    }
+
+    for (const auto &[time, glucose] : values.gluc) {
+        if (!std::isfinite(time) || !std::isfinite(glucose)) {
+            throw std::invalid_argument("The points of the glucose curve have to be finite numbers");
+        }
+    }
+}
+
+void CortisolCytokinesConfiguration::validate(const CortisolCytokinesModel::State &initial_conditions) {
+    for (std::size_t i = 0; i < initial_conditions.size(); i++) {
+        if (!std::isfinite(initial_conditions[i]) || initial_conditions[i] < 0) {
+            throw std::invalid_argument("The initial condition of " + std::string(CortisolCytokinesModel::STATE_NAMES[i]) + " has to be a non-negative number");
+        }
+    }
+}
@@ -0,0 +1,137 @@
+#include "cortisol_cytokines_integrator.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <nlohmann/json.hpp>
+#include <stdexcept>
+#include <string>
+
+#include "cortisol_cytokines_model.hpp"
+
+CortisolCytokinesIntegrator::Solver CortisolCytokinesIntegrator::parseSolver(const std::string &name) {
+    if (name == "dopri5") {
+        return Solver::Dopri5;
+    } else if (name == "cash_karp54") {
+        return Solver::CashKarp54;
+    } else if (name == "rosenbrock4") {
+        return Solver::Rosenbrock4;
+    }
+
+    throw std::invalid_argument("Unknown solver: " + name);
+}
+
+std::string CortisolCytokinesIntegrator::solverName(Solver solver) {
+    switch (solver) {
+        case Solver::CashKarp54:
+            return "cash_karp54";
+        case Solver::Rosenbrock4:
+            return "rosenbrock4";
+        default:
+            return "dopri5";
+    }
+}
+
+CortisolCytokinesIntegrator::CortisolCytokinesIntegrator(Solver solver, double absolute_tolerance, double relative_tolerance, double output_interval) {
+    this->solver = solver;
+    this->absolute_tolerance = absolute_tolerance;
+    this->relative_tolerance = relative_tolerance;
+    this->output_interval = output_interval;
+}
+
+void CortisolCytokinesIntegrator::parseSettings(const nlohmann::basic_json<> &json_file) {
+    if (!json_file.contains("solver")) {
+        return;
+    }
+
+    const auto &settings = json_file.at("solver");
+
+    if (settings.contains("method")) {
+        this->solver = parseSolver(settings.at("method").get<std::string>());
+    }
+
+    this->absolute_tolerance = settings.value("absolute_tolerance", this->absolute_tolerance);
+    this->relative_tolerance = settings.value("relative_tolerance", this->relative_tolerance);
+
+    if (settings.contains("output_interval")) {
+        // given in minutes, the model runs in days
+        this->output_interval = settings.at("output_interval").get<double>() / (24 * 60);
+    }
+
+    if (!(this->absolute_tolerance > 0) || !(this->relative_tolerance > 0) || this->output_interval < 0) {
+        throw std::invalid_argument("Solver tolerances have to be positive and the output interval can't be negative");
+    }
+}
+
+void CortisolCytokinesIntegrator::applyOverrides(const Overrides &overrides) {
+    this->solver = overrides.solver.value_or(this->solver);
+    this->absolute_tolerance = overrides.absolute_tolerance.value_or(this->absolute_tolerance);
+    this->relative_tolerance = overrides.relative_tolerance.value_or(this->relative_tolerance);
+    this->output_interval = overrides.output_interval.value_or(this->output_interval);
+}
+
+void CortisolCytokinesIntegrator::setSolver(Solver solver) {
+    this->solver = solver;
+}
+
+void CortisolCytokinesIntegrator::setAbsoluteTolerance(double absolute_tolerance) {
+    this->absolute_tolerance = absolute_tolerance;
+}
+
+void CortisolCytokinesIntegrator::setRelativeTolerance(double relative_tolerance) {
+    this->relative_tolerance = relative_tolerance;
+}
+
+void CortisolCytokinesIntegrator::setOutputInterval(double output_interval) {
+    this->output_interval = output_interval;
+}
+
+void CortisolCytokinesIntegrator::setInitialStep(double initial_step) {
+    this->initial_step = initial_step;
+}
+
+void CortisolCytokinesIntegrator::setStatistics(Statistics *statistics) {
+    this->statistics = statistics;
+}
+
+CortisolCytokinesIntegrator::Solver CortisolCytokinesIntegrator::getSolver() const {
+    return this->solver;
+}
+
+double CortisolCytokinesIntegrator::getOutputInterval() const {
+    return this->output_interval;
+}
+
+void CortisolCytokinesIntegrator::ImplicitSystem::operator()(const ImplicitState &x, ImplicitState &dxdt, double T) const {
+    CortisolCytokinesModel::State state;
+    CortisolCytokinesModel::State derivatives;
+    std::copy(x.begin(), x.end(), state.begin());
+
+    if (this->statistics != nullptr) {
+        this->statistics->rhs_evaluations++;
+    }
+
+    model(state, derivatives, T);
+
+    std::copy(derivatives.begin(), derivatives.end(), dxdt.begin());
+}
+
+void CortisolCytokinesIntegrator::ImplicitJacobianSystem::operator()(const ImplicitState &x, ImplicitJacobian &J, double T, ImplicitState &dfdt) const {
+    CortisolCytokinesModel::State state;
+    CortisolCytokinesModel::Jacobian matrix;
+    CortisolCytokinesModel::State time_derivatives;
+    std::copy(x.begin(), x.end(), state.begin());
+
+    if (this->statistics != nullptr) {
+        this->statistics->jacobian_evaluations++;
+    }
+
+    this->jacobian(state, matrix, T, time_derivatives);
+
+    for (std::size_t i = 0; i < matrix.size(); i++) {
+        for (std::size_t j = 0; j < matrix[i].size(); j++) {
+            J(i, j) = matrix[i][j];
+        }
+    }
+
+    std::copy(time_derivatives.begin(), time_derivatives.end(), dfdt.begin());
+}
@@ -1,12 +1,14 @@
 #include "cortisol_cytokines_model.hpp"
 
 #include <fmt/ranges.h>
-#include <matplot/matplot.h>
 
+#include <algorithm>
 #include <cmath>
-#include <filesystem>
+#include <cstddef>
+#include <memory>
 #include <nlohmann/json.hpp>
 #include <string>
+#include <utility>
 
 #include "utilities.hpp"
 
@@ -17,17 +19,79 @@
     #include <chrono>
 #endif
 
+CortisolCytokinesModel::State CortisolCytokinesModel::readInitialConditions(const nlohmann::basic_json<> &json_file) {
+    const auto &initial_conditions = json_file.at("initial_conditions");
+    State state;
+
+    for (std::size_t i = 0; i < state.size(); i++) {
+        state[i] = initial_conditions.at(std::string(STATE_NAMES[i]));
+    }
+
+    return state;
+}
+
+CortisolCytokinesModel::CortisolCytokinesModel() {
+    setDefaultParameters();
+}
+
+CortisolCytokinesModel::CortisolCytokinesModel(std::shared_ptr<const CortisolCytokinesValues> values): values(std::move(values)) {}
+
 void CortisolCytokinesModel::setParameters(const nlohmann::basic_json<> &json_file) {
-    CortisolCytokinesModel::values.setValues(json_file);
-    CortisolCytokinesModel::get_closest_value.setValues(CortisolCytokinesModel::values.gluc);
+    auto values = std::make_shared<CortisolCytokinesValues>();
+    values->parseValues(json_file);
+
+    this->values = std::move(values);
 }
 
 void CortisolCytokinesModel::setDefaultParameters() {
-    CortisolCytokinesModel::values.setDefaultValues();
-    CortisolCytokinesModel::get_closest_value.setValues(CortisolCytokinesModel::values.gluc);
+    auto values = std::make_shared<CortisolCytokinesValues>();
+    values->setDefaultValues();
+
+    this->values = std::move(values);
 }
 
-void CortisolCytokinesModel::operator()(const std::vector<double> &x, std::vector<double> &dxdt, const double T) const {
+void CortisolCytokinesModel::setValues(std::shared_ptr<const CortisolCytokinesValues> values) {
+    this->values = std::move(values);
+}
+
+const CortisolCytokinesValues &CortisolCytokinesModel::getValues() const {
+    return *this->values;
+}
+
+CortisolCytokinesModel::HillTerms CortisolCytokinesModel::hillTerms(const State &x) const {
+    const double IL10 = x[3];
+    const double IL6 = x[4];
+    const double TNF = x[6];
+
+    const CortisolCytokinesValues &values = *this->values;
+
+    HillTerms terms;
+
+    terms.tnf_h_mtnf = values.h_mtnf_power(TNF);
+    terms.il10_h_m10 = values.h_m10_power(IL10);
+    terms.il6_h_106 = values.h_106_power(IL6);
+    terms.tnf_h_6tnf = values.h_6tnf_power(TNF);
+    terms.il6_h_66 = values.h_66_power(IL6);
+    terms.il10_n_610 = values.n_610_power(IL10);
+    terms.tnf_h_8tnf = values.h_8tnf_power(TNF);
+    terms.il10_h_810 = values.h_810_power(IL10);
+    terms.il6_h_tnf6 = values.h_tnf6_power(IL6);
+    terms.il10_h_tnf10 = values.h_tnf10_power(IL10);
+
+    terms.mtnf = terms.tnf_h_mtnf / (values.n_mtnf_h_mtnf + terms.tnf_h_mtnf);
+    terms.m10 = values.n_m10_h_m10 / (values.n_m10_h_m10 + terms.il10_h_m10);
+    terms.il10_il6 = terms.il6_h_106 / (values.n_106_h_106 + terms.il6_h_106);
+    terms.il6_tnf = terms.tnf_h_6tnf / (values.n_6tnf_h_6tnf + terms.tnf_h_6tnf);
+    terms.il6_il6 = values.n_66_h_66 / (values.n_66_h_66 + terms.il6_h_66);
+    terms.il6_il10 = values.n_610_h_610 / (values.n_610_h_610 + terms.il10_n_610);
+    terms.il8_tnf = terms.tnf_h_8tnf / (terms.tnf_h_8tnf + values.n_8tnf_h_8tnf);
+    terms.tnf_il6 = values.n_tnf6_h_tnf6 / (values.n_tnf6_h_tnf6 + terms.il6_h_tnf6);
+    terms.tnf_il10 = values.n_tnf10_h_tnf10 / (values.n_tnf10_h_tnf10 + terms.il10_h_tnf10);
+
+    return terms;
+}
+
+void CortisolCytokinesModel::operator()(const State &x, State &dxdt, const double T) const {
     const double A = x[0];
     const double MA = x[1];
     const double MR = x[2];
@@ -37,196 +101,133 @@ void CortisolCytokinesModel::operator()(const std::vector<double> &x, std::vecto
     const double TNF = x[6];
     const double COR = x[7];
 
-    const double DADT = CortisolCytokinesModel::values.beta_a * A *
-                            (1 - (A / CortisolCytokinesModel::values.k_a)) -
-                        CortisolCytokinesModel::values.m_a * A * MA;
-
-    const double DMADT = (CortisolCytokinesModel::values.k_m + CortisolCytokinesModel::values.k_mtnf *
-                                                                   (pow(TNF, CortisolCytokinesModel::values.h_mtnf) /
-                                                                    (pow(CortisolCytokinesModel::values.n_mtnf, CortisolCytokinesModel::values.h_mtnf) + pow(TNF, CortisolCytokinesModel::values.h_mtnf))
-                                                                   ) *
-                                                                   (pow(CortisolCytokinesModel::values.n_m10, CortisolCytokinesModel::values.h_m10) /
-                                                                    (pow(CortisolCytokinesModel::values.n_m10, CortisolCytokinesModel::values.h_m10) + pow(IL10, CortisolCytokinesModel::values.h_m10))
-                                                                   )
-                         ) * MR *
-                             A -
-                         CortisolCytokinesModel::values.k_ma * MA;
-
-    const double DMRDT = -(CortisolCytokinesModel::values.k_m + CortisolCytokinesModel::values.k_mtnf *
-                                                                    (pow(TNF, CortisolCytokinesModel::values.h_mtnf) /
-                                                                     (pow(CortisolCytokinesModel::values.n_mtnf, CortisolCytokinesModel::values.h_mtnf) + pow(TNF, CortisolCytokinesModel::values.h_mtnf))
-                                                                    ) *
-                                                                    (pow(CortisolCytokinesModel::values.n_m10, CortisolCytokinesModel::values.h_m10) /
-                                                                     (pow(CortisolCytokinesModel::values.n_m10, CortisolCytokinesModel::values.h_m10) + pow(IL10, CortisolCytokinesModel::values.h_m10))
-                                                                    )
-                         ) * MR *
-                             A +
-                         CortisolCytokinesModel::values.k_mr * MR * (1 - MR / CortisolCytokinesModel::values.mr_max);
-
-    const double DIL10DT = (CortisolCytokinesModel::values.k_10m + CortisolCytokinesModel::values.k_106 *
-                                                                       (pow(IL6, CortisolCytokinesModel::values.h_106) /
-                                                                        (pow(CortisolCytokinesModel::values.n_106, CortisolCytokinesModel::values.h_106) + pow(IL6, CortisolCytokinesModel::values.h_106))
-                                                                       )
-                           ) * MA -
-                           CortisolCytokinesModel::values.k_10 * (IL10 - CortisolCytokinesModel::values.q_il10);
-
-    const double DIL6DT = (CortisolCytokinesModel::values.k_6m + CortisolCytokinesModel::values.k_6tnf *
-                                                                     (pow(TNF, CortisolCytokinesModel::values.h_6tnf) /
-                                                                      (pow(CortisolCytokinesModel::values.n_6tnf, CortisolCytokinesModel::values.h_6tnf) + pow(TNF, CortisolCytokinesModel::values.h_6tnf))
-                                                                     ) *
-                                                                     (pow(CortisolCytokinesModel::values.n_66, CortisolCytokinesModel::values.h_66) /
-                                                                      (pow(CortisolCytokinesModel::values.n_66, CortisolCytokinesModel::values.h_66) + pow(IL6, CortisolCytokinesModel::values.h_66))
-                                                                     ) *
-                                                                     (pow(CortisolCytokinesModel::values.n_610, CortisolCytokinesModel::values.h_610) /
-                                                                      (pow(CortisolCytokinesModel::values.n_610, CortisolCytokinesModel::values.h_610) + pow(IL10, CortisolCytokinesModel::values.n_610))
-                                                                     )
-                          ) * MA -
-                          CortisolCytokinesModel::values.klt6 * COR *
-                              (1 - COR / (COR + CortisolCytokinesModel::values.kmct)) -
-                          CortisolCytokinesModel::values.k_6 * (IL6 - CortisolCytokinesModel::values.q_il6);
-
-    const double DIL8DT = (CortisolCytokinesModel::values.k_8m + CortisolCytokinesModel::values.k_8tnf *
-                                                                     (pow(TNF, CortisolCytokinesModel::values.h_8tnf) /
-                                                                      (pow(TNF, CortisolCytokinesModel::values.h_8tnf) + pow(CortisolCytokinesModel::values.n_8tnf, CortisolCytokinesModel::values.h_8tnf))
-                                                                     ) *
-                                                                     (pow(CortisolCytokinesModel::values.n_810, CortisolCytokinesModel::values.h_610) /
-                                                                          (pow(CortisolCytokinesModel::values.n_810, CortisolCytokinesModel::values.h_810)) +
-                                                                      pow(IL10, CortisolCytokinesModel::values.h_810)
-                                                                     )
-                          ) * MA -
-                          CortisolCytokinesModel::values.k_8 * (IL8 - CortisolCytokinesModel::values.q_il8);
-
-    const double DTNFDT = (CortisolCytokinesModel::values.k_tnfm *
-                           (pow(CortisolCytokinesModel::values.n_tnf6, CortisolCytokinesModel::values.h_tnf6) /
-                            (pow(CortisolCytokinesModel::values.n_tnf6, CortisolCytokinesModel::values.h_tnf6) + pow(IL6, CortisolCytokinesModel::values.h_tnf6))
-                           ) *
-                           (pow(CortisolCytokinesModel::values.n_tnf10, CortisolCytokinesModel::values.h_tnf10) /
-                            (pow(CortisolCytokinesModel::values.n_tnf10, CortisolCytokinesModel::values.h_tnf10) + pow(IL10, CortisolCytokinesModel::values.h_tnf10))
-                           )
-                          ) * MA -
-                          CortisolCytokinesModel::values.klt * COR *
-                              (1 - COR / (COR + CortisolCytokinesModel::values.kmct)) -
-                          CortisolCytokinesModel::values.k_tnf * (TNF - CortisolCytokinesModel::values.q_tnf);
-
-    const double DCORDT = CortisolCytokinesModel::values.ktc *
-                              (TNF / (TNF + CortisolCytokinesModel::values.kmtc)) *
-                              (CortisolCytokinesModel::values.cmax - COR) * CortisolCytokinesModel::get_closest_value.find(T - int(T)) -
-                          CortisolCytokinesModel::values.kcd * COR;
-
-    dxdt[0] = DADT;
-    dxdt[1] = DMADT;
-    dxdt[2] = DMRDT;
-    dxdt[3] = DIL10DT;
-    dxdt[4] = DIL6DT;
-    dxdt[5] = DIL8DT;
-    dxdt[6] = DTNFDT;
-    dxdt[7] = DCORDT;
-}
+    const CortisolCytokinesValues &values = *this->values;
+    const HillTerms hill = hillTerms(x);
 
-void CortisolCytokinesModel::plotResults(const std::vector<std::vector<double>> &states, const std::vector<double> &times) {
-    const std::array<std::string, 8> FILE_NAMES = {"antigen", "active_macrophage", "resting_macrophage", "il10", "il6", "il8", "tnf", "cortisol"};
-    std::array<std::vector<double>, 8> separated_states;
+    // terms shared between multiple equations are only evaluated once
+    const double MACROPHAGE_ACTIVATION = (values.k_m + values.k_mtnf * hill.mtnf * hill.m10) * MR * A;
+    const double CORTISOL_INHIBITION = COR * (1 - COR / (COR + values.kmct));
 
-    for (const auto &state : states) {
-        for (int i = 0; i < 8; i++) {
-            separated_states[i].push_back(state[i]);
-        }
-    }
+    const double DADT = values.beta_a * A * (1 - (A / values.k_a)) -
+                        values.m_a * A * MA;
 
-#ifndef NDEBUG
-    auto previous_plot_time = std::chrono::high_resolution_clock::now();
-#endif
+    const double DMADT = MACROPHAGE_ACTIVATION - values.k_ma * MA;
 
-    for (int i = 0; i < 8; i++) {
-        auto figure = matplot::figure(true);
-        figure->backend()->run_command("unset warnings");
-        auto axes = figure->current_axes();
-        axes->plot(times, separated_states[i]);
+    const double DMRDT = -MACROPHAGE_ACTIVATION + values.k_mr * MR * (1 - MR / values.mr_max);
 
-        const std::filesystem::path FILE_PATH = "output/" + FILE_NAMES[i] + ".png";
-        figure->save(FILE_PATH.string());
+    const double DIL10DT = (values.k_10m + values.k_106 * hill.il10_il6) * MA -
+                           values.k_10 * (IL10 - values.q_il10);
 
-#ifndef NDEBUG
-        auto current_plot_time = std::chrono::high_resolution_clock::now();
-        auto current_plot_duration = std::chrono::duration_cast<std::chrono::microseconds>(current_plot_time - previous_plot_time);
+    const double DIL6DT = (values.k_6m + values.k_6tnf * hill.il6_tnf * hill.il6_il6 * hill.il6_il10) * MA -
+                          values.klt6 * CORTISOL_INHIBITION -
+                          values.k_6 * (IL6 - values.q_il6);
 
-        fmt::print(fg(fmt::color::dark_golden_rod) | fmt::emphasis::bold, "->{} plotting done. Plotting duration: {} ({})\n", FILE_NAMES[i], current_plot_duration, std::chrono::duration_cast<std::chrono::seconds>(current_plot_duration));
+    const double DIL8DT = (values.k_8m + values.k_8tnf * hill.il8_tnf * (values.n_810_h_610_over_h_810 + hill.il10_h_810)) * MA -
+                          values.k_8 * (IL8 - values.q_il8);
 
-        previous_plot_time = current_plot_time;
-#endif
-    }
-};
+    const double DTNFDT = (values.k_tnfm * hill.tnf_il6 * hill.tnf_il10) * MA -
+                          values.klt * CORTISOL_INHIBITION -
+                          values.k_tnf * (TNF - values.q_tnf);
 
-void CortisolCytokinesModel::plotDailyAverage(const std::vector<std::vector<double>> &states, const std::vector<double> &times) {
-    const std::array<std::string, 8> FILE_NAMES = {"antigen", "active_macrophage", "resting_macrophage", "il10", "il6", "il8", "tnf", "cortisol"};
-    std::array<std::vector<double>, 8> separated_states;
+    const double DCORDT = values.ktc * (TNF / (TNF + values.kmtc)) *
+                              (values.cmax - COR) * values.gluc_table(T - int(T)) -
+                          values.kcd * COR;
 
-#ifndef NDEBUG
-    auto start_average_calculation_time = std::chrono::high_resolution_clock::now();
-
-    fmt::print(fg(fmt::color::dark_golden_rod) | fmt::emphasis::bold, "->Starting average calculation.\n");
-#endif
-
-    int index = 0;
-    // - 1 to prevent the last day from being plotted and messing up the graph
-    // due to the way the simulation is ran the last day will always only have 1 value,
-    // that value tends to be considerably different from the daily average and, thus,
-    // causes a spike downwards on the graph of most of the metrics
-    while (index < times.size() - 1) {
-        int current_index = index + 1;
-
-        std::array<double, 8> sums;
-        for (int j = 0; j < sums.size(); j++) {
-            sums[j] = states[index][j];
-        }
-
-        while (current_index < times.size() && int(times[current_index]) - int(times[index]) < 1) {
-            for (int j = 0; j < sums.size(); j++) {
-                sums[j] += states[current_index][j];
-            }
+    dxdt[0] = DADT;
+    dxdt[1] = DMADT;
+    dxdt[2] = DMRDT;
+    dxdt[3] = DIL10DT;
+    dxdt[4] = DIL6DT;
+    dxdt[5] = DIL8DT;
+    dxdt[6] = DTNFDT;
+    dxdt[7] = DCORDT;
+}
 
-            current_index++;
-        }
+void CortisolCytokinesModel::jacobian(const State &x, Jacobian &J, const double T, State &dfdt) const {
+    const double A = x[0];
+    const double MA = x[1];
+    const double MR = x[2];
+    const double IL10 = x[3];
+    const double IL6 = x[4];
+    const double TNF = x[6];
+    const double COR = x[7];
 
-        for (int j = 0; j < sums.size(); j++) {
-            separated_states[j].push_back(sums[j] / (current_index - index + 1));
-        }
+    const CortisolCytokinesValues &values = *this->values;
+    const HillTerms hill = hillTerms(x);
 
-        index = current_index;
-    }
+    // every hill function is either x^h / (n^h + x^h) or n^h / (n^h + x^h), their derivatives are
+    // ±n^h * (x^h)' / (n^h + x^h)^2
+    const auto hill_derivative = [](double n_h, double x_h, double x_h_derivative) {
+        return n_h * x_h_derivative / ((n_h + x_h) * (n_h + x_h));
+    };
 
-    std::vector<int> days;
-    for (int index = 0; index < separated_states[0].size(); index++) {
-        days.push_back(index);
+    for (auto &row : J) {
+        row.fill(0);
     }
 
-#ifndef NDEBUG
-    auto end_average_calculation_time = std::chrono::high_resolution_clock::now();
-    auto average_calculation_duration = std::chrono::duration_cast<std::chrono::microseconds>(end_average_calculation_time - start_average_calculation_time);
-
-    fmt::print(fg(fmt::color::dark_golden_rod) | fmt::emphasis::bold, "->Daily average calculation done. Calculation duration: {} ({})\n", average_calculation_duration, std::chrono::duration_cast<std::chrono::seconds>(average_calculation_duration));
-#endif
-
-#ifndef NDEBUG
-    auto previous_plot_time = std::chrono::high_resolution_clock::now();
-#endif
-
-    for (int i = 0; i < 8; i++) {
-        auto figure = matplot::figure(true);
-        figure->backend()->run_command("unset warnings");
-        auto axes = figure->current_axes();
-        axes->plot(days, separated_states[i]);
-
-        const std::filesystem::path FILE_PATH = "output/" + FILE_NAMES[i] + "_average" + ".png";
-        figure->save(FILE_PATH.string());
+    dfdt.fill(0);
+
+    const double ACTIVATION_RATE = values.k_m + values.k_mtnf * hill.mtnf * hill.m10;
+    // partial derivatives of MACROPHAGE_ACTIVATION
+    const double ACTIVATION_A = ACTIVATION_RATE * MR;
+    const double ACTIVATION_MR = ACTIVATION_RATE * A;
+    const double ACTIVATION_TNF = values.k_mtnf * hill_derivative(values.n_mtnf_h_mtnf, hill.tnf_h_mtnf, values.h_mtnf_power.derivative(TNF)) * hill.m10 * MR * A;
+    const double ACTIVATION_IL10 = -values.k_mtnf * hill.mtnf * hill_derivative(values.n_m10_h_m10, hill.il10_h_m10, values.h_m10_power.derivative(IL10)) * MR * A;
+
+    // d/dCOR of COR * (1 - COR / (COR + kmct)) = COR * kmct / (COR + kmct)
+    const double CORTISOL_INHIBITION_COR = (values.kmct * values.kmct) / ((COR + values.kmct) * (COR + values.kmct));
+
+    J[0][0] = values.beta_a * (1 - 2 * A / values.k_a) - values.m_a * MA;
+    J[0][1] = -values.m_a * A;
+
+    J[1][0] = ACTIVATION_A;
+    J[1][1] = -values.k_ma;
+    J[1][2] = ACTIVATION_MR;
+    J[1][3] = ACTIVATION_IL10;
+    J[1][6] = ACTIVATION_TNF;
+
+    J[2][0] = -ACTIVATION_A;
+    J[2][2] = -ACTIVATION_MR + values.k_mr * (1 - 2 * MR / values.mr_max);
+    J[2][3] = -ACTIVATION_IL10;
+    J[2][6] = -ACTIVATION_TNF;
+
+    J[3][1] = values.k_10m + values.k_106 * hill.il10_il6;
+    J[3][3] = -values.k_10;
+    J[3][4] = values.k_106 * hill_derivative(values.n_106_h_106, hill.il6_h_106, values.h_106_power.derivative(IL6)) * MA;
+
+    J[4][1] = values.k_6m + values.k_6tnf * hill.il6_tnf * hill.il6_il6 * hill.il6_il10;
+    J[4][3] = -values.k_6tnf * hill.il6_tnf * hill.il6_il6 * hill_derivative(values.n_610_h_610, hill.il10_n_610, values.n_610_power.derivative(IL10)) * MA;
+    J[4][4] = -values.k_6tnf * hill.il6_tnf * hill_derivative(values.n_66_h_66, hill.il6_h_66, values.h_66_power.derivative(IL6)) * hill.il6_il10 * MA - values.k_6;
+    J[4][6] = values.k_6tnf * hill_derivative(values.n_6tnf_h_6tnf, hill.tnf_h_6tnf, values.h_6tnf_power.derivative(TNF)) * hill.il6_il6 * hill.il6_il10 * MA;
+    J[4][7] = -values.klt6 * CORTISOL_INHIBITION_COR;
+
+    const double IL8_IL10 = values.n_810_h_610_over_h_810 + hill.il10_h_810;
+    J[5][1] = values.k_8m + values.k_8tnf * hill.il8_tnf * IL8_IL10;
+    J[5][3] = values.k_8tnf * hill.il8_tnf * values.h_810_power.derivative(IL10) * MA;
+    J[5][5] = -values.k_8;
+    J[5][6] = values.k_8tnf * hill_derivative(values.n_8tnf_h_8tnf, hill.tnf_h_8tnf, values.h_8tnf_power.derivative(TNF)) * IL8_IL10 * MA;
+
+    J[6][1] = values.k_tnfm * hill.tnf_il6 * hill.tnf_il10;
+    J[6][3] = -values.k_tnfm * hill.tnf_il6 * hill_derivative(values.n_tnf10_h_tnf10, hill.il10_h_tnf10, values.h_tnf10_power.derivative(IL10)) * MA;
+    J[6][4] = -values.k_tnfm * hill_derivative(values.n_tnf6_h_tnf6, hill.il6_h_tnf6, values.h_tnf6_power.derivative(IL6)) * hill.tnf_il10 * MA;
+    J[6][6] = -values.k_tnf;
+    J[6][7] = -values.klt * CORTISOL_INHIBITION_COR;
+
+    const double GLUCOSE = values.gluc_table(T - int(T));
+    const double TNF_SATURATION = TNF / (TNF + values.kmtc);
+    J[7][6] = values.ktc * (values.kmtc / ((TNF + values.kmtc) * (TNF + values.kmtc))) * (values.cmax - COR) * GLUCOSE;
+    J[7][7] = -values.ktc * TNF_SATURATION * GLUCOSE - values.kcd;
+
+    // the glucose curve is the only explicit dependency on time
+    dfdt[7] = values.ktc * TNF_SATURATION * (values.cmax - COR) * values.gluc_table.slope(T - int(T));
+}
 
-#ifndef NDEBUG
-        auto current_plot_time = std::chrono::high_resolution_clock::now();
-        auto current_plot_duration = std::chrono::duration_cast<std::chrono::microseconds>(current_plot_time - previous_plot_time);
+CortisolCytokinesModel::JacobianFunction CortisolCytokinesModel::getJacobianFunction() const {
+    return JacobianFunction(*this);
+}
 
-        fmt::print(fg(fmt::color::dark_golden_rod) | fmt::emphasis::bold, "->{} average plotting done. Plotting duration: {} ({})\n", FILE_NAMES[i], current_plot_duration, std::chrono::duration_cast<std::chrono::seconds>(current_plot_duration));
+CortisolCytokinesModel::JacobianFunction::JacobianFunction(const CortisolCytokinesModel &model): model(model) {}
 
-        previous_plot_time = current_plot_time;
-#endif
-    }
-};
+void CortisolCytokinesModel::JacobianFunction::operator()(const State &x, Jacobian &J, const double T, State &dfdt) const {
+    model.jacobian(x, J, T, dfdt);
+}
@@ -0,0 +1,97 @@
+#include "cortisol_cytokines_plots.hpp"
+
+#include <fmt/base.h>
+#include <matplot/matplot.h>
+
+#include <array>
+#include <filesystem>
+#include <future>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "daily_statistics.hpp"
+#include "thread_pool.hpp"
+#include "trajectory.hpp"
+#include "utilities.hpp"
+
+#ifndef NDEBUG
+    #include <fmt/chrono.h>
+    #include <fmt/color.h>
+
+    #include <chrono>
+#endif
+
+// matplot++ keeps the figures and their axes in global state, so they're set up one at a time and only the
+// saving, where gnuplot renders the file, runs in parallel
+static std::mutex figure_mutex;
+
+// renders values over times into output/file_name.png
+static void plotSeries(const std::vector<double> &times, const std::vector<double> &values, const std::string &file_name) {
+#ifndef NDEBUG
+    auto plot_start = std::chrono::high_resolution_clock::now();
+#endif
+
+    matplot::figure_handle figure;
+
+    {
+        std::scoped_lock lock(figure_mutex);
+
+        figure = matplot::figure(true);
+        figure->backend()->run_command("unset warnings");
+
+        auto axes = figure->current_axes();
+        // gnuplot's time grows with the amount of points, but no more than two of them can be told apart per pixel
+        const auto [decimated_times, decimated_values] = Utilities::decimateMinMax(times, values, figure->width());
+        axes->plot(decimated_times, decimated_values);
+    }
+
+    const std::filesystem::path FILE_PATH = "output/" + file_name + ".png";
+    figure->save(FILE_PATH.string());
+
+#ifndef NDEBUG
+    auto plot_end = std::chrono::high_resolution_clock::now();
+    auto plot_duration = std::chrono::duration_cast<std::chrono::microseconds>(plot_end - plot_start);
+
+    fmt::print(fg(fmt::color::dark_golden_rod) | fmt::emphasis::bold, "->{} plotting done. Plotting duration: {} ({})\n", file_name, plot_duration, std::chrono::duration_cast<std::chrono::seconds>(plot_duration));
+#endif
+}
+
+std::vector<std::future<void>> CortisolCytokinesPlots::plotResults(const Trajectory &trajectory, Utilities::ThreadPool &pool) {
+    const std::array<std::string, 8> FILE_NAMES = {"antigen", "active_macrophage", "resting_macrophage", "il10", "il6", "il8", "tnf", "cortisol"};
+
+    std::vector<std::future<void>> plots;
+
+    for (int i = 0; i < 8; i++) {
+        plots.push_back(pool.submit([&trajectory, i, file_name = FILE_NAMES[i]] {
+            plotSeries(trajectory.times(), trajectory.state(i), file_name);
+        }));
+    }
+
+    return plots;
+};
+
+std::vector<std::future<void>> CortisolCytokinesPlots::plotDailyAverage(const Utilities::DailyStatistics &daily_statistics, Utilities::ThreadPool &pool) {
+    const std::array<std::string, 8> FILE_NAMES = {"antigen", "active_macrophage", "resting_macrophage", "il10", "il6", "il8", "tnf", "cortisol"};
+
+    std::vector<std::future<void>> plots;
+
+    for (int i = 0; i < 8; i++) {
+        plots.push_back(pool.submit([&daily_statistics, i, file_name = FILE_NAMES[i] + "_average"] {
+            plotSeries(daily_statistics.days(), daily_statistics.column(i, Utilities::DailyStatistics::Mean), file_name);
+        }));
+    }
+
+    return plots;
+};
+
+std::vector<std::future<void>> CortisolCytokinesPlots::plotSimulation(const Trajectory &trajectory, const Utilities::DailyStatistics &daily_statistics, Utilities::ThreadPool &pool) {
+    std::vector<std::future<void>> plots = plotResults(trajectory, pool);
+
+    for (auto &plot : plotDailyAverage(daily_statistics, pool)) {
+        plots.push_back(std::move(plot));
+    }
+
+    return plots;
+}
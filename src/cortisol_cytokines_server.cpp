@@ -0,0 +1,237 @@
+#include "cortisol_cytokines_server.hpp"
+
+#include <fmt/base.h>
+#include <fmt/color.h>
+
+#include <cstddef>
+#include <exception>
+#include <filesystem>
+#include <istream>
+#include <map>
+#include <mutex>
+#include <nlohmann/json.hpp>
+#include <optional>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "cortisol_cytokines_configuration.hpp"
+#include "cortisol_cytokines_integrator.hpp"
+#include "cortisol_cytokines_model.hpp"
+#include "daily_statistics.hpp"
+#include "thread_pool.hpp"
+#include "trajectory.hpp"
+
+namespace {
+    nlohmann::json stateToJson(const CortisolCytokinesModel::State &state) {
+        nlohmann::json json_state = nlohmann::json::object();
+
+        for (std::size_t i = 0; i < state.size(); i++) {
+            json_state[std::string(CortisolCytokinesModel::STATE_NAMES[i])] = state[i];
+        }
+
+        return json_state;
+    }
+
+    // throws nlohmann::json::exception, std::invalid_argument and std::out_of_range for invalid jobs
+    nlohmann::json runJob(const nlohmann::json &job, const CortisolCytokinesConfiguration &base, int default_days, const CortisolCytokinesIntegrator::Overrides &integrator_overrides, std::optional<double> steady_state_override) {
+        // shares the base's parameters unless the job changes them
+        CortisolCytokinesConfiguration configuration = base;
+
+        if (job.contains("parameters")) {
+            configuration.setParameters(job.at("parameters").get<std::map<std::string, double>>());
+        }
+
+        if (job.contains("initial_conditions")) {
+            const auto &initial_conditions = job.at("initial_conditions");
+            CortisolCytokinesModel::State state = configuration.getInitialConditions();
+
+            for (const auto &[name, value] : initial_conditions.items()) {
+                std::size_t i = 0;
+
+                while (i < state.size() && CortisolCytokinesModel::STATE_NAMES[i] != name) {
+                    i++;
+                }
+
+                if (i == state.size()) {
+                    throw std::out_of_range("Unknown state variable: " + name);
+                }
+
+                state[i] = value.get<double>();
+            }
+
+            configuration.setInitialConditions(state);
+        }
+
+        CortisolCytokinesIntegrator integrator = configuration.getIntegrator();
+        integrator.parseSettings(job);
+        integrator.applyOverrides(integrator_overrides);
+
+        const int days = job.value("days", default_days);
+        const double steady_state_tolerance = steady_state_override.value_or(job.value("steady_state", 0.0));
+        const bool keep_trajectory = job.value("trajectory", false);
+        const bool keep_daily_statistics = job.value("daily_statistics", false);
+
+        if (days <= 0) {
+            throw std::invalid_argument("The amount of days has to be positive");
+        }
+
+        if (steady_state_tolerance < 0) {
+            throw std::invalid_argument("The steady state tolerance can't be negative");
+        }
+
+        const CortisolCytokinesModel model = configuration.getModel();
+        CortisolCytokinesModel::State state = configuration.getInitialConditions();
+        Trajectory trajectory;
+        Utilities::DailyStatistics daily_statistics;
+
+        auto observer = [&](const CortisolCytokinesModel::State &x, double T) {
+            if (keep_trajectory) {
+                trajectory.push_back(x, T);
+            }
+
+            if (keep_daily_statistics) {
+                daily_statistics(x, T);
+            }
+        };
+
+        nlohmann::json result = nlohmann::json::object();
+
+        if (steady_state_tolerance > 0) {
+            const double cycle_time = integrator.integratePeriodic(model, state, 0.0, double(days), CortisolCytokinesModel::PERIOD, steady_state_tolerance, observer);
+
+            // integratePeriodic returns the end time when no cycle was reached
+            result["cycle_reached"] = cycle_time < days ? nlohmann::json(cycle_time) : nlohmann::json(nullptr);
+        } else {
+            integrator.integrate(model, state, 0.0, double(days), observer);
+        }
+
+        result["final_state"] = stateToJson(state);
+
+        if (keep_trajectory) {
+            nlohmann::json json_trajectory = {{"time", trajectory.times()}};
+
+            for (std::size_t i = 0; i < trajectory.stateSize(); i++) {
+                json_trajectory[std::string(CortisolCytokinesModel::STATE_NAMES[i])] = trajectory.state(i);
+            }
+
+            result["trajectory"] = std::move(json_trajectory);
+        }
+
+        if (keep_daily_statistics) {
+            daily_statistics.finish();
+
+            nlohmann::json json_statistics = {{"day", daily_statistics.days()}};
+
+            for (std::size_t i = 0; i < CortisolCytokinesModel::STATE_NAMES.size(); i++) {
+                nlohmann::json variable_statistics = nlohmann::json::object();
+
+                for (std::size_t statistic = 0; statistic < Utilities::DailyStatistics::STATISTIC_COUNT; statistic++) {
+                    variable_statistics[Utilities::DailyStatistics::STATISTIC_NAMES[statistic]] = daily_statistics.column(i, Utilities::DailyStatistics::Statistic(statistic));
+                }
+
+                json_statistics[std::string(CortisolCytokinesModel::STATE_NAMES[i])] = std::move(variable_statistics);
+            }
+
+            result["daily_statistics"] = std::move(json_statistics);
+        }
+
+        return result;
+    }
+}  // namespace
+
+CortisolCytokinesServer::CortisolCytokinesServer(std::filesystem::path input_path, int days, std::size_t thread_count, CortisolCytokinesIntegrator::Overrides integrator_overrides, std::optional<double> steady_state_tolerance) {
+    this->input_path = input_path;
+    this->days = days;
+    this->thread_count = thread_count;
+    this->integrator_overrides = integrator_overrides;
+    this->steady_state_tolerance = steady_state_tolerance;
+}
+
+void CortisolCytokinesServer::setInputPath(std::filesystem::path input_path) {
+    this->input_path = input_path;
+}
+
+void CortisolCytokinesServer::setDays(int days) {
+    this->days = days;
+}
+
+void CortisolCytokinesServer::setThreadCount(std::size_t thread_count) {
+    this->thread_count = thread_count;
+}
+
+void CortisolCytokinesServer::setIntegratorOverrides(CortisolCytokinesIntegrator::Overrides integrator_overrides) {
+    this->integrator_overrides = integrator_overrides;
+}
+
+void CortisolCytokinesServer::setSteadyStateTolerance(double steady_state_tolerance) {
+    this->steady_state_tolerance = steady_state_tolerance;
+}
+
+void CortisolCytokinesServer::startServer(std::istream &input, std::ostream &output) const {
+    CortisolCytokinesConfiguration base;
+
+    if (!this->input_path.empty()) {
+        base = CortisolCytokinesConfiguration::readFile(this->input_path);
+    }
+
+    // each answer is a single line, written whole
+    std::mutex output_mutex;
+    // a tied input flushes the output before every read, from this thread and without the lock
+    input.tie(nullptr);
+
+    auto respond = [&output, &output_mutex](const nlohmann::json &response) {
+        const std::string line = response.dump();
+
+        std::scoped_lock lock(output_mutex);
+        output << line << '\n';
+        output.flush();
+    };
+
+    std::string line;
+
+    {
+        // destroying the pool waits for every job, so their futures aren't kept
+        Utilities::ThreadPool thread_pool(this->thread_count);
+
+        // the output is the protocol, so the messages go to stderr
+        fmt::print(stderr, "Serving on {} threads.\n", thread_pool.size());
+
+        while (std::getline(input, line)) {
+            if (line.find_first_not_of(" \t\r") == std::string::npos) {
+                continue;
+            }
+
+            nlohmann::json job;
+
+            try {
+                job = nlohmann::json::parse(line);
+            } catch (const nlohmann::json::parse_error &exception) {
+                respond({{"id", nullptr}, {"error", exception.what()}});
+
+                continue;
+            }
+
+            if (!job.is_object()) {
+                respond({{"id", nullptr}, {"error", "Jobs have to be json objects"}});
+
+                continue;
+            }
+
+            thread_pool.submit([job = std::move(job), &base, &respond, days = this->days, this]() {
+                const nlohmann::json id = job.value("id", nlohmann::json());
+                nlohmann::json response;
+
+                try {
+                    response = runJob(job, base, days, this->integrator_overrides, this->steady_state_tolerance);
+                } catch (const std::exception &exception) {
+                    response = {{"error", exception.what()}};
+                }
+
+                response["id"] = id;
+                respond(response);
+            });
+        }
+    }
+}
@@ -4,13 +4,32 @@
 #include <fmt/color.h>
 #include <fmt/ranges.h>
 
-#include <boost/numeric/odeint/integrate/integrate.hpp>
+#include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <exception>
 #include <filesystem>
 #include <fstream>
+#include <functional>
+#include <future>
+#include <limits>
+#include <memory>
 #include <nlohmann/json.hpp>
-
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "checkpoint.hpp"
+#include "cortisol_cytokines_configuration.hpp"
+#include "cortisol_cytokines_integrator.hpp"
 #include "cortisol_cytokines_model.hpp"
+#include "daily_statistics.hpp"
+#include "metrics.hpp"
+#include "thread_pool.hpp"
+#include "trajectory.hpp"
 #include "utilities.hpp"
 
 #ifndef NDEBUG
@@ -18,6 +37,62 @@
     #include <fmt/color.h>
 #endif
 
+// measured on the default configuration, only used to reserve the trajectory up front
+constexpr std::size_t ESTIMATED_SAMPLES_PER_DAY = 240;
+
+// the writers throw std::runtime_error once the output can't be written, which ends the run, the status is
+// kept below 256 since only the low byte of it reaches the shell
+[[noreturn]] static void exitOnOutputError(const std::exception &exception) {
+    fmt::print(stderr, fg(fmt::color::dark_red) | fmt::emphasis::bold, "Error writing output: {}\n", exception.what());
+
+    exit(4);
+}
+
+static void reportCycle(double cycle_time, double end_time) {
+    if (cycle_time < end_time) {
+        fmt::print(stderr, "Steady state cycle reached on day {}, the remaining {} days repeat it.\n", cycle_time, end_time - cycle_time);
+    } else {
+        fmt::print(stderr, fg(fmt::color::dark_golden_rod), "No steady state cycle was reached.\n");
+    }
+}
+
+// the cycle search as the checkpoint stores it and back, with the samples flattened
+static Utilities::Checkpoint::CycleSearch saveCycleSearch(const CortisolCytokinesIntegrator::CycleSearch &cycle_search) {
+    Utilities::Checkpoint::CycleSearch saved;
+    saved.origin = cycle_search.origin;
+    saved.periods = cycle_search.periods;
+    saved.section.assign(cycle_search.section.begin(), cycle_search.section.end());
+    saved.reached = cycle_search.reached;
+    saved.cycle_time = cycle_search.cycle_time;
+
+    for (const auto &[x, T] : cycle_search.cycle) {
+        saved.cycle.push_back(T);
+        saved.cycle.insert(saved.cycle.end(), x.begin(), x.end());
+    }
+
+    return saved;
+}
+
+static CortisolCytokinesIntegrator::CycleSearch loadCycleSearch(const Utilities::Checkpoint::CycleSearch &saved) {
+    CortisolCytokinesIntegrator::CycleSearch cycle_search;
+    cycle_search.origin = saved.origin;
+    cycle_search.periods = std::size_t(saved.periods);
+    std::copy(saved.section.begin(), saved.section.end(), cycle_search.section.begin());
+    cycle_search.reached = saved.reached;
+    cycle_search.cycle_time = saved.cycle_time;
+
+    constexpr std::size_t sample_size = std::tuple_size_v<CortisolCytokinesModel::State> + 1;
+
+    for (auto sample = saved.cycle.begin(); sample != saved.cycle.end(); sample += sample_size) {
+        CortisolCytokinesModel::State x;
+        std::copy(sample + 1, sample + sample_size, x.begin());
+
+        cycle_search.cycle.emplace_back(x, *sample);
+    }
+
+    return cycle_search;
+}
+
 CortisolCytokinesSimulation::CortisolCytokinesSimulation(std::filesystem::path input_path, int days, bool plot, bool csv) {
     this->input_path = input_path;
     this->days = days;
@@ -33,6 +108,10 @@ void CortisolCytokinesSimulation::setInputPath(std::filesystem::path input_path)
     this->input_path = input_path;
 }
 
+void CortisolCytokinesSimulation::setConfiguration(CortisolCytokinesConfiguration configuration) {
+    this->configuration = std::move(configuration);
+}
+
 void CortisolCytokinesSimulation::setPlot(bool plot) {
     this->plot = plot;
 }
@@ -41,51 +120,199 @@ void CortisolCytokinesSimulation::setCsv(bool csv) {
     this->csv = csv;
 }
 
+void CortisolCytokinesSimulation::setStream(bool stream) {
+    this->stream = stream;
+}
+
+void CortisolCytokinesSimulation::setBinary(bool binary) {
+    this->binary = binary;
+}
+
+void CortisolCytokinesSimulation::setBinaryPrecision(Utilities::BinarySink::Precision binary_precision) {
+    this->binary_precision = binary_precision;
+}
+
+void CortisolCytokinesSimulation::setBlockSize(std::size_t block_size) {
+    this->block_size = block_size;
+}
+
+void CortisolCytokinesSimulation::setCsvPrecision(int csv_precision) {
+    this->csv_precision = csv_precision;
+}
+
+void CortisolCytokinesSimulation::setCompress(bool compress) {
+    this->compress = compress;
+}
+
+void CortisolCytokinesSimulation::setDailyStatistics(bool daily_statistics) {
+    this->daily_statistics = daily_statistics;
+}
+
+void CortisolCytokinesSimulation::setIntegratorOverrides(CortisolCytokinesIntegrator::Overrides integrator_overrides) {
+    this->integrator_overrides = integrator_overrides;
+}
+
+void CortisolCytokinesSimulation::setSolver(CortisolCytokinesIntegrator::Solver solver) {
+    this->integrator_overrides.solver = solver;
+}
+
+void CortisolCytokinesSimulation::setAbsoluteTolerance(double absolute_tolerance) {
+    this->integrator_overrides.absolute_tolerance = absolute_tolerance;
+}
+
+void CortisolCytokinesSimulation::setRelativeTolerance(double relative_tolerance) {
+    this->integrator_overrides.relative_tolerance = relative_tolerance;
+}
+
+void CortisolCytokinesSimulation::setOutputInterval(double output_interval) {
+    this->integrator_overrides.output_interval = output_interval;
+}
+
+void CortisolCytokinesSimulation::setSteadyStateTolerance(double steady_state_tolerance) {
+    this->steady_state_tolerance = steady_state_tolerance;
+}
+
+void CortisolCytokinesSimulation::setCheckpointPath(std::filesystem::path checkpoint_path) {
+    this->checkpoint_path = checkpoint_path;
+}
+
+void CortisolCytokinesSimulation::setCheckpointInterval(double checkpoint_interval) {
+    this->checkpoint_interval = checkpoint_interval;
+}
+
+void CortisolCytokinesSimulation::setResume(bool resume) {
+    this->resume = resume;
+}
+
+void CortisolCytokinesSimulation::setPlotter(Plotter plotter) {
+    this->plotter = std::move(plotter);
+}
+
+void CortisolCytokinesSimulation::setMetricsPath(std::filesystem::path metrics_path) {
+    this->metrics_path = metrics_path;
+}
+
+template<class Observer>
+void CortisolCytokinesSimulation::integrate(const CortisolCytokinesModel &cortisol_cytokines_model, const CortisolCytokinesIntegrator &integrator, CortisolCytokinesModel::State &state, double start_time, double end_time, Observer observer, double *next_step, CortisolCytokinesIntegrator::CycleSearch *cycle_search) const {
+    if (!this->steady_state_tolerance) {
+        integrator.integrate(cortisol_cytokines_model, state, start_time, end_time, observer, next_step);
+
+        return;
+    }
+
+    if (cycle_search != nullptr) {
+        integrator.continuePeriodic(cortisol_cytokines_model, state, start_time, end_time, CortisolCytokinesModel::PERIOD, *this->steady_state_tolerance, *cycle_search, observer, next_step);
+
+        return;
+    }
+
+    reportCycle(integrator.integratePeriodic(cortisol_cytokines_model, state, start_time, end_time, CortisolCytokinesModel::PERIOD, *this->steady_state_tolerance, observer, next_step), end_time);
+}
+
+void CortisolCytokinesSimulation::writeDailyStatistics(const Utilities::DailyStatistics &daily_statistics, const std::vector<std::string> &header) const {
+    // the first column of the header is the time
+    const std::vector<std::string> variable_names(header.begin() + 1, header.end());
+
+    try {
+        Utilities::writeCsv(daily_statistics.header(variable_names), daily_statistics.columns(), this->compress ? "output/daily.csv.gz" : "output/daily.csv", this->csv_precision);
+    } catch (const std::runtime_error &exception) {
+        exitOnOutputError(exception);
+    }
+
+    fmt::print("Daily statistics of {} days written.\n", daily_statistics.size());
+}
+
+void CortisolCytokinesSimulation::writeMetrics(Utilities::Metrics &metrics, const CortisolCytokinesIntegrator &integrator, const CortisolCytokinesIntegrator::Statistics &solver_statistics) const {
+    using Statistics = CortisolCytokinesIntegrator::Statistics;
+
+    nlohmann::ordered_json step_sizes = nlohmann::ordered_json::array();
+
+    // the first and last bins are open ended
+    for (std::size_t i = 0; i < Statistics::STEP_SIZE_BINS; i++) {
+        const int decade = Statistics::SMALLEST_STEP_DECADE + int(i);
+
+        step_sizes.push_back({
+            {"from", i == 0 ? nlohmann::ordered_json(nullptr) : nlohmann::ordered_json(std::pow(10.0, decade))},
+            {"to", i + 1 == Statistics::STEP_SIZE_BINS ? nlohmann::ordered_json(nullptr) : nlohmann::ordered_json(std::pow(10.0, decade + 1))},
+            {"count", solver_statistics.step_size_histogram[i]}
+        });
+    }
+
+    metrics.set("days", this->days);
+    metrics.set("solver", {
+        {"method", CortisolCytokinesIntegrator::solverName(integrator.getSolver())},
+        {"rhs_evaluations", solver_statistics.rhs_evaluations},
+        {"jacobian_evaluations", solver_statistics.jacobian_evaluations},
+        {"accepted_steps", solver_statistics.accepted_steps},
+        {"rejected_steps", solver_statistics.rejected_steps},
+        {"step_sizes", step_sizes}
+    });
+
+    try {
+        metrics.write(this->metrics_path);
+    } catch (const std::exception &exception) {
+        fmt::print(stderr, fg(fmt::color::dark_red) | fmt::emphasis::bold, "Error writing metrics: {}\n", exception.what());
+
+        return;
+    }
+
+    fmt::print("Metrics written to {}.\n", this->metrics_path.string());
+}
+
 void CortisolCytokinesSimulation::startSimulation() const {
-    CortisolCytokinesModel cortisol_cytokines_model;
-    std::vector<double> initial_conditions = {2, 5, 10, 0.7, 0, 0, 0.17, 2.32};
+    CortisolCytokinesIntegrator::Statistics solver_statistics;
+    Utilities::Metrics metrics;
 
-    if (!this->input_path.empty()) {
-        try {
-            std::ifstream file_stream(input_path);
-            auto json_file = nlohmann::json::parse(file_stream);
-            auto custom_initial_conditions = json_file.at("initial_conditions");
-
-            initial_conditions = {
-                custom_initial_conditions.at("antigens"),
-                custom_initial_conditions.at("active_macrophages"),
-                custom_initial_conditions.at("resting_macrophages"),
-                custom_initial_conditions.at("il-10"),
-                custom_initial_conditions.at("il-6"),
-                custom_initial_conditions.at("il-8"),
-                custom_initial_conditions.at("tnf-alpha"),
-                custom_initial_conditions.at("cortisol")
-            };
-
-            cortisol_cytokines_model.setParameters(json_file);
-        } catch (const nlohmann::json::parse_error &exception) {
-            fmt::print(stderr, fg(fmt::color::dark_red) | fmt::emphasis::bold, "Error reading from file {}.\n", input_path.string());
+    metrics.startPhase("parse");
 
-#ifndef NDEBUG
-            fmt::print(fg(fmt::color::dark_golden_rod) | fmt::emphasis::bold, "{}", exception.what());
-#endif
+    // starts with the default parameters
+    CortisolCytokinesConfiguration configuration;
 
-            exit(512);
-        } catch (const nlohmann::json::basic_json::out_of_range &exception) {
-            fmt::print(stderr, fg(fmt::color::dark_red) | fmt::emphasis::bold, "Error reading attribute from file.\n");
+    if (this->configuration) {
+        configuration = *this->configuration;
+    } else if (!this->input_path.empty()) {
+        configuration = CortisolCytokinesConfiguration::readFile(this->input_path);
+    }
 
-#ifndef NDEBUG
-            fmt::print(fg(fmt::color::dark_golden_rod) | fmt::emphasis::bold, "{}", exception.what());
-#endif
+    const CortisolCytokinesModel cortisol_cytokines_model = configuration.getModel();
+    CortisolCytokinesModel::State initial_conditions = configuration.getInitialConditions();
+    CortisolCytokinesIntegrator integrator = configuration.getIntegrator();
+
+    integrator.applyOverrides(this->integrator_overrides);
+
+    // counting is only paid for when it's reported
+    if (!this->metrics_path.empty()) {
+        integrator.setStatistics(&solver_statistics);
+    }
+
+    metrics.stopPhase("parse");
+
+    const std::vector<std::string> HEADER = {"Time", "Antigens", "Active Macrophages", "Resting Macrophages", "IL10", "IL6", "IL8", "TNF-ɑ", "Cortisol"};
 
-            exit(513);
+    if (this->stream) {
+        streamSimulation(cortisol_cytokines_model, integrator, initial_conditions, HEADER, metrics);
+
+        if (!this->metrics_path.empty()) {
+            writeMetrics(metrics, integrator, solver_statistics);
         }
-    } else {
-        cortisol_cytokines_model.setDefaultParameters();
+
+        return;
     }
 
-    std::vector<std::vector<double>> states;
-    std::vector<double> times;
+    // the engine doesn't render figures by itself, see setPlotter
+    const bool plot = this->plot && this->plotter;
+
+    if (this->plot && !this->plotter) {
+        fmt::print(fg(fmt::color::dark_golden_rod), "Plotting isn't available in this build, the figures are skipped.\n");
+    }
+
+    Trajectory trajectory;
+
+    if (integrator.getOutputInterval() > 0) {
+        trajectory.reserve(std::size_t(days / integrator.getOutputInterval()) + 1);
+    } else {
+        trajectory.reserve(std::size_t(days) * ESTIMATED_SAMPLES_PER_DAY);
+    }
 
     fmt::print("Starting simulation.\n");
 
@@ -93,7 +320,30 @@ void CortisolCytokinesSimulation::startSimulation() const {
     auto simulation_start = std::chrono::high_resolution_clock::now();
 #endif
 
-    boost::numeric::odeint::integrate(cortisol_cytokines_model, initial_conditions, 0.0, double(days), 0.0001, Utilities::IntegralObserver(states, times));
+    // the daily averages are plotted from the daily statistics
+    Utilities::DailyStatistics daily_statistics;
+
+    metrics.startPhase("integrate");
+
+    if (plot || this->daily_statistics) {
+        Utilities::IntegralObserver integral_observer(trajectory);
+
+        integrate(cortisol_cytokines_model, integrator, initial_conditions, 0.0, double(days), [&](const CortisolCytokinesModel::State &x, double T) {
+            integral_observer(x, T);
+            daily_statistics(x, T);
+        });
+
+        metrics.stopPhase("integrate");
+        // the statistics are accumulated while integrating, only the last day is left to close
+        metrics.startPhase("aggregate");
+        daily_statistics.finish();
+        metrics.stopPhase("aggregate");
+    } else {
+        integrate(cortisol_cytokines_model, integrator, initial_conditions, 0.0, double(days), Utilities::IntegralObserver(trajectory));
+        metrics.stopPhase("integrate");
+    }
+
+    metrics.set("samples", trajectory.size());
 
 #ifndef NDEBUG
     auto simulation_end = std::chrono::high_resolution_clock::now();
@@ -104,15 +354,82 @@ void CortisolCytokinesSimulation::startSimulation() const {
 
     fmt::print("Simulation done.\n");
 
-    if (this->plot) {
+    // the figures are rendered by the pool while the trajectory is written out
+    std::optional<Utilities::ThreadPool> plotting_pool;
+    std::vector<std::future<void>> plots;
+
+#ifndef NDEBUG
+    auto plotting_start = std::chrono::high_resolution_clock::now();
+#endif
+
+    if (plot) {
         fmt::print("\nStarting plotting.\n");
 
+        // overlaps with writing, so this is the time until the last figure is done
+        metrics.startPhase("plot");
+        plotting_pool.emplace();
+        plots = this->plotter(trajectory, daily_statistics, *plotting_pool);
+    }
+
+    metrics.startPhase("write");
+
+    if (this->binary) {
+        fmt::print("\nStarting binary write.\n");
+
+#ifndef NDEBUG
+        auto binary_start = std::chrono::high_resolution_clock::now();
+#endif
+
+        // the whole trajectory is a single batch, so every column ends up contiguous
+        try {
+            Utilities::BinarySink sink(HEADER, "output/values.bin", false, this->binary_precision);
+            sink.writeBlock(trajectory);
+            sink.close();
+        } catch (const std::runtime_error &exception) {
+            exitOnOutputError(exception);
+        }
+
+#ifndef NDEBUG
+        auto binary_end = std::chrono::high_resolution_clock::now();
+        auto binary_duration = std::chrono::duration_cast<std::chrono::microseconds>(binary_end - binary_start);
+        fmt::print(fg(fmt::color::dark_golden_rod) | fmt::emphasis::bold, "Binary write duration: {} ({})\n", binary_duration, std::chrono::duration_cast<std::chrono::seconds>(binary_duration));
+#endif
+
+        fmt::print("Binary write done.\n");
+    } else if (this->csv) {
+        fmt::print("\nStarting CSV write.\n");
+
+#ifndef NDEBUG
+        auto csv_start = std::chrono::high_resolution_clock::now();
+#endif
+
+        try {
+            Utilities::writeCsv(HEADER, trajectory.columns(), this->compress ? "output/values.csv.gz" : "output/values.csv", this->csv_precision);
+        } catch (const std::runtime_error &exception) {
+            exitOnOutputError(exception);
+        }
+
 #ifndef NDEBUG
-        auto plotting_start = std::chrono::high_resolution_clock::now();
+        auto csv_end = std::chrono::high_resolution_clock::now();
+        auto csv_duration = std::chrono::duration_cast<std::chrono::microseconds>(csv_end - csv_start);
+        fmt::print(fg(fmt::color::dark_golden_rod) | fmt::emphasis::bold, "CSV write duration: {} ({})\n", csv_duration, std::chrono::duration_cast<std::chrono::seconds>(csv_duration));
 #endif
 
-        CortisolCytokinesModel::plotResults(states, times);
-        CortisolCytokinesModel::plotDailyAverage(states, times);
+        fmt::print("CSV write done.\n");
+    }
+
+    if (this->daily_statistics) {
+        writeDailyStatistics(daily_statistics, HEADER);
+    }
+
+    metrics.stopPhase("write");
+
+    if (plot) {
+        for (auto &figure : plots) {
+            figure.get();
+        }
+
+        metrics.stopPhase("plot");
 
 #ifndef NDEBUG
         auto plotting_end = std::chrono::high_resolution_clock::now();
@@ -124,39 +441,212 @@ void CortisolCytokinesSimulation::startSimulation() const {
         fmt::print("Plotting done.\n");
     }
 
-    if (this->csv) {
-        fmt::print("\nStarting CSV write.\n");
+    if (!this->metrics_path.empty()) {
+        writeMetrics(metrics, integrator, solver_statistics);
+    }
+}
+
+void CortisolCytokinesSimulation::streamSimulation(const CortisolCytokinesModel &cortisol_cytokines_model, CortisolCytokinesIntegrator integrator, CortisolCytokinesModel::State initial_conditions, const std::vector<std::string> &header, Utilities::Metrics &metrics) const {
+    if (this->plot) {
+        fmt::print(fg(fmt::color::dark_golden_rod), "Plotting requires the whole trajectory and is disabled while streaming.\n");
+    }
+
+    const std::filesystem::path output_path = this->binary ? "output/values.bin" : (this->compress ? "output/values.csv.gz" : "output/values.csv");
+    const bool has_output = this->binary || this->csv;
+    double start_time = 0;
+    // looks for the steady state across all the chunks, instead of starting over in each of them
+    std::optional<CortisolCytokinesIntegrator::CycleSearch> cycle_search;
+
+    if (this->resume) {
+        Utilities::Checkpoint checkpoint;
+
+        try {
+            checkpoint = Utilities::Checkpoint::read(this->checkpoint_path);
+
+            if (checkpoint.state.size() != initial_conditions.size()) {
+                throw std::runtime_error("The checkpoint's state doesn't belong to this model");
+            }
+
+            if (checkpoint.cycle_search && checkpoint.cycle_search->cycle.size() % (initial_conditions.size() + 1) != 0) {
+                throw std::runtime_error("The checkpoint's cycle doesn't belong to this model");
+            }
+
+            // the output may have grown past the checkpoint before the run was interrupted, those samples are
+            // integrated again, but it can't be shorter than what the checkpoint expects
+            if (has_output && (!std::filesystem::exists(output_path) || std::filesystem::file_size(output_path) < checkpoint.output_size)) {
+                throw std::runtime_error(output_path.string() + " is shorter than when the checkpoint was written");
+            }
+        } catch (const std::runtime_error &exception) {
+            fmt::print(stderr, fg(fmt::color::dark_red) | fmt::emphasis::bold, "Error resuming from checkpoint: {}\n", exception.what());
+
+            exit(4);
+        }
+
+        if (has_output) {
+            std::filesystem::resize_file(output_path, checkpoint.output_size);
+        }
+
+        std::copy(checkpoint.state.begin(), checkpoint.state.end(), initial_conditions.begin());
+        start_time = checkpoint.time;
+        integrator.setInitialStep(checkpoint.step_size);
+
+        // a checkpoint of a run that wasn't looking for the steady state starts the search where it resumes
+        if (checkpoint.cycle_search && this->steady_state_tolerance) {
+            cycle_search = loadCycleSearch(*checkpoint.cycle_search);
+        }
+
+        fmt::print("Resuming from day {}.\n", start_time);
+    }
+
+    std::unique_ptr<Utilities::TrajectorySink> sink;
+
+    if (this->binary) {
+        try {
+            sink = std::make_unique<Utilities::BinarySink>(header, output_path, this->resume, this->binary_precision);
+        } catch (const std::runtime_error &exception) {
+            fmt::print(stderr, fg(fmt::color::dark_red) | fmt::emphasis::bold, "Error opening output: {}\n", exception.what());
+
+            exit(4);
+        }
+    } else if (this->csv) {
+        try {
+            sink = std::make_unique<Utilities::CsvSink>(header, output_path, this->resume, this->csv_precision);
+        } catch (const std::runtime_error &exception) {
+            fmt::print(stderr, fg(fmt::color::dark_red) | fmt::emphasis::bold, "Error opening output: {}\n", exception.what());
+
+            exit(4);
+        }
+    } else {
+        fmt::print(fg(fmt::color::dark_golden_rod), "No output selected, the streamed samples will be discarded.\n");
+    }
+
+    std::optional<Utilities::StreamingObserver> observer;
+
+    if (sink) {
+        observer.emplace(*sink, this->block_size);
+    }
+
+    Utilities::DailyStatistics daily_statistics;
+    std::size_t samples = 0;
+
+    auto observe = [&observer, &daily_statistics, &samples, track_days = this->daily_statistics](const CortisolCytokinesModel::State &x, double T) {
+        samples++;
+
+        if (observer) {
+            try {
+                (*observer)(x, T);
+            } catch (const std::runtime_error &exception) {
+                exitOnOutputError(exception);
+            }
+        }
+
+        if (track_days) {
+            daily_statistics(x, T);
+        }
+    };
+
+    fmt::print("Starting simulation.\n");
 
 #ifndef NDEBUG
-        auto csv_start = std::chrono::high_resolution_clock::now();
-        auto csv_combination_start = std::chrono::high_resolution_clock::now();
+    auto simulation_start = std::chrono::high_resolution_clock::now();
 #endif
 
-        auto combined_state_time = Utilities::combineStateWithTimeVector(states, times);
+    // the samples are written as they come, so this includes most of the writing
+    metrics.startPhase("integrate");
 
-#ifndef NDEBUG
-        auto csv_combination_end = std::chrono::high_resolution_clock::now();
-        auto csv_combination_duration = std::chrono::duration_cast<std::chrono::microseconds>(csv_combination_end - csv_combination_start);
-        fmt::print(fg(fmt::color::dark_golden_rod) | fmt::emphasis::bold, "->Finished combining time with states. Combination duration: {} ({})\n", csv_combination_duration, std::chrono::duration_cast<std::chrono::seconds>(csv_combination_duration));
+    if (this->checkpoint_path.empty()) {
+        integrate(cortisol_cytokines_model, integrator, initial_conditions, start_time, double(days), observe);
+    } else {
+        // integrated in chunks with a checkpoint after each of them, every chunk starts where the previous one (or
+        // the resumed run) ended, which has already been observed if it was observed at all
+        double last_observed_time = this->resume ? start_time : -std::numeric_limits<double>::infinity();
+
+        auto chunk_observer = [&](const CortisolCytokinesModel::State &x, double T) {
+            if (T <= last_observed_time) {
+                return;
+            }
+
+            last_observed_time = T;
+            observe(x, T);
+        };
+
+        if (this->steady_state_tolerance && !cycle_search) {
+            cycle_search.emplace();
+            cycle_search->origin = start_time;
+            cycle_search->section = initial_conditions;
+        }
 
-        auto csv_writing_start = std::chrono::high_resolution_clock::now();
-#endif
+        for (double chunk_start = start_time; chunk_start < double(days);) {
+            const double chunk_end = std::min(chunk_start + this->checkpoint_interval, double(days));
+
+            Utilities::Checkpoint checkpoint;
 
-        Utilities::writeCsv(
-            {"Time", "Antigens", "Active Macrophages", "Resting Macrophages", "IL10", "IL6", "IL8", "TNF-ɑ", "Cortisol"},
-            combined_state_time
-        );
+            // the step size the next chunk continues with, so that a resumed run takes the same steps
+            integrate(cortisol_cytokines_model, integrator, initial_conditions, chunk_start, chunk_end, chunk_observer, &checkpoint.step_size, cycle_search ? &*cycle_search : nullptr);
+
+            checkpoint.state.assign(initial_conditions.begin(), initial_conditions.end());
+            checkpoint.time = chunk_end;
+
+            if (cycle_search) {
+                checkpoint.cycle_search = saveCycleSearch(*cycle_search);
+            }
+
+            if (observer) {
+                try {
+                    observer->flush();
+                    checkpoint.output_size = sink->flush();
+                } catch (const std::runtime_error &exception) {
+                    exitOnOutputError(exception);
+                }
+            }
+
+            try {
+                checkpoint.write(this->checkpoint_path);
+            } catch (const std::exception &exception) {
+                // losing a checkpoint doesn't affect the simulation itself
+                fmt::print(stderr, fg(fmt::color::dark_red) | fmt::emphasis::bold, "Error writing checkpoint: {}\n", exception.what());
+            }
+
+            integrator.setInitialStep(checkpoint.step_size);
+            chunk_start = chunk_end;
+        }
+
+        if (cycle_search) {
+            reportCycle(cycle_search->reached ? cycle_search->cycle_time : double(days), double(days));
+        }
+    }
+
+    metrics.stopPhase("integrate");
+    metrics.set("samples", samples);
+    metrics.startPhase("write");
+
+    if (sink) {
+        try {
+            observer->flush();
+            sink->close();
+        } catch (const std::runtime_error &exception) {
+            exitOnOutputError(exception);
+        }
+    }
+
+    metrics.stopPhase("write");
+
+    if (this->daily_statistics) {
+        metrics.startPhase("aggregate");
+        daily_statistics.finish();
+        metrics.stopPhase("aggregate");
+
+        metrics.startPhase("write");
+        writeDailyStatistics(daily_statistics, header);
+        metrics.stopPhase("write");
+    }
 
 #ifndef NDEBUG
-        auto csv_writing_end = std::chrono::high_resolution_clock::now();
-        auto csv_writing_duration = std::chrono::duration_cast<std::chrono::microseconds>(csv_writing_end - csv_writing_start);
-        fmt::print(fg(fmt::color::dark_golden_rod) | fmt::emphasis::bold, "->Finished writing CSV. CSV writing duration: {} ({})\n", csv_writing_duration, std::chrono::duration_cast<std::chrono::seconds>(csv_writing_duration));
+    auto simulation_end = std::chrono::high_resolution_clock::now();
 
-        auto csv_end = std::chrono::high_resolution_clock::now();
-        auto csv_duration = std::chrono::duration_cast<std::chrono::microseconds>(csv_end - csv_start);
-        fmt::print(fg(fmt::color::dark_golden_rod) | fmt::emphasis::bold, "CSV write duration: {} ({})\n", csv_duration, std::chrono::duration_cast<std::chrono::seconds>(csv_duration));
+    auto simulation_duration = std::chrono::duration_cast<std::chrono::microseconds>(simulation_end - simulation_start);
+    fmt::print(fg(fmt::color::dark_golden_rod) | fmt::emphasis::bold, "Simulation duration: {} ({})\n", simulation_duration, std::chrono::duration_cast<std::chrono::seconds>(simulation_duration));
 #endif
 
-        fmt::print("CSV write done.\n");
-    }
+    fmt::print("Simulation done.\n");
 }
@@ -0,0 +1,302 @@
+#include "cortisol_cytokines_sweep.hpp"
+
+#include <fmt/base.h>
+#include <fmt/color.h>
+#include <fmt/os.h>
+#include <fmt/ranges.h>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <filesystem>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <nlohmann/json.hpp>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "cortisol_cytokines_batch_model.hpp"
+#include "cortisol_cytokines_configuration.hpp"
+#include "cortisol_cytokines_integrator.hpp"
+#include "cortisol_cytokines_model.hpp"
+#include "cortisol_cytokines_values.hpp"
+#include "thread_pool.hpp"
+
+namespace {
+    using Overrides = std::map<std::string, double>;
+
+    // time weighted mean, maximum and final value of every state variable, computed as the
+    // integration runs so that the trajectories never have to be stored
+    // every operation is element wise, so it works on the packed states of the batch model as well
+    template<class State = CortisolCytokinesModel::State>
+    class SummaryObserver {
+        public:
+            State integral = {};
+            State maximum = {};
+            State last = {};
+            double start_time = 0;
+            double last_time = 0;
+            bool empty = true;
+
+            void operator()(const State &x, double t) {
+                for (std::size_t i = 0; i < x.size(); i++) {
+                    if (empty) {
+                        maximum[i] = x[i];
+                    } else {
+                        // trapezoidal rule
+                        integral[i] += (x[i] + last[i]) * (t - last_time) / 2;
+                        maximum[i] = std::max(maximum[i], x[i]);
+                    }
+                }
+
+                if (empty) {
+                    start_time = t;
+                    empty = false;
+                }
+
+                last = x;
+                last_time = t;
+            }
+
+            State mean() const {
+                State mean = last;
+                const double duration = last_time - start_time;
+
+                if (duration > 0) {
+                    for (std::size_t i = 0; i < mean.size(); i++) {
+                        mean[i] = integral[i] / duration;
+                    }
+                }
+
+                return mean;
+            }
+    };
+
+    std::vector<Overrides> expandScenarios(const nlohmann::json &sweep_file) {
+        std::vector<Overrides> scenarios;
+
+        if (sweep_file.contains("scenarios")) {
+            for (const auto &scenario : sweep_file.at("scenarios")) {
+                scenarios.push_back(scenario.get<Overrides>());
+            }
+        } else {
+            scenarios.emplace_back();
+        }
+
+        if (sweep_file.contains("grid")) {
+            for (const auto &[name, grid_values] : sweep_file.at("grid").items()) {
+                std::vector<Overrides> expanded_scenarios;
+
+                for (const auto &scenario : scenarios) {
+                    for (double value : grid_values) {
+                        Overrides expanded_scenario = scenario;
+                        expanded_scenario[name] = value;
+
+                        expanded_scenarios.push_back(std::move(expanded_scenario));
+                    }
+                }
+
+                scenarios = std::move(expanded_scenarios);
+            }
+        }
+
+        return scenarios;
+    }
+}  // namespace
+
+CortisolCytokinesSweep::CortisolCytokinesSweep(std::filesystem::path sweep_path, int days, std::size_t thread_count, CortisolCytokinesIntegrator::Overrides integrator_overrides, std::optional<double> steady_state_tolerance) {
+    this->sweep_path = sweep_path;
+    this->days = days;
+    this->thread_count = thread_count;
+    this->integrator_overrides = integrator_overrides;
+    this->steady_state_tolerance = steady_state_tolerance;
+}
+
+void CortisolCytokinesSweep::setDays(int days) {
+    this->days = days;
+}
+
+void CortisolCytokinesSweep::setThreadCount(std::size_t thread_count) {
+    this->thread_count = thread_count;
+}
+
+void CortisolCytokinesSweep::setIntegratorOverrides(CortisolCytokinesIntegrator::Overrides integrator_overrides) {
+    this->integrator_overrides = integrator_overrides;
+}
+
+void CortisolCytokinesSweep::setSteadyStateTolerance(double steady_state_tolerance) {
+    this->steady_state_tolerance = steady_state_tolerance;
+}
+
+void CortisolCytokinesSweep::startSweep() const {
+    // default parameters without a base configuration
+    CortisolCytokinesConfiguration base;
+    std::vector<Overrides> scenarios;
+    std::filesystem::path output_path = "output/sweep.csv";
+    double step_size = 0;
+    CortisolCytokinesIntegrator integrator;
+    double steady_state_tolerance = 0;
+
+    const auto sweep_file = CortisolCytokinesConfiguration::readJson(sweep_path);
+
+    if (sweep_file.contains("base")) {
+        base = CortisolCytokinesConfiguration::readFile(sweep_path.parent_path() / sweep_file.at("base").get<std::string>());
+        integrator = base.getIntegrator();
+    }
+
+    // the sweep's own solver settings take precedence over the base configuration's
+    integrator.parseSettings(sweep_file);
+    integrator.applyOverrides(this->integrator_overrides);
+
+    if (sweep_file.contains("output")) {
+        output_path = sweep_file.at("output").get<std::string>();
+    }
+
+    if (sweep_file.contains("step_size")) {
+        step_size = sweep_file.at("step_size");
+
+        if (step_size <= 0) {
+            throw std::invalid_argument(fmt::format("Invalid step size: {}", step_size));
+        }
+    }
+
+    if (sweep_file.contains("steady_state")) {
+        steady_state_tolerance = sweep_file.at("steady_state");
+
+        if (steady_state_tolerance <= 0) {
+            throw std::invalid_argument(fmt::format("Invalid steady state tolerance: {}", steady_state_tolerance));
+        }
+    }
+
+    if (this->steady_state_tolerance) {
+        steady_state_tolerance = *this->steady_state_tolerance;
+    }
+
+    scenarios = expandScenarios(sweep_file);
+
+    const CortisolCytokinesModel::State initial_conditions = base.getInitialConditions();
+
+    // every parameter changed by any scenario gets a column on the output
+    std::set<std::string> parameter_names;
+    std::vector<std::shared_ptr<const CortisolCytokinesValues>> scenario_values;
+
+    for (const auto &scenario : scenarios) {
+        CortisolCytokinesConfiguration configuration = base;
+
+        // unknown names are std::out_of_range and invalid values std::invalid_argument
+        configuration.setParameters(scenario);
+
+        for (const auto &[name, value] : scenario) {
+            parameter_names.insert(name);
+        }
+
+        scenario_values.push_back(configuration.getValues());
+    }
+
+    Utilities::ThreadPool thread_pool(this->thread_count);
+
+    fmt::print("Starting sweep of {} scenarios on {} threads.\n", scenarios.size(), thread_pool.size());
+
+    std::vector<std::future<SummaryObserver<>>> summaries;
+    std::vector<std::future<std::array<SummaryObserver<>, BATCH_SIZE>>> batch_summaries;
+
+    if (step_size > 0) {
+        using BatchModel = CortisolCytokinesBatchModel<BATCH_SIZE>;
+
+        for (std::size_t first = 0; first < scenario_values.size(); first += BATCH_SIZE) {
+            // the last batch is filled with copies of it's last scenario, their results are discarded
+            std::vector<std::shared_ptr<const CortisolCytokinesValues>> batch_values;
+
+            for (std::size_t lane = 0; lane < BATCH_SIZE; lane++) {
+                batch_values.push_back(scenario_values[std::min(first + lane, scenario_values.size() - 1)]);
+            }
+
+            batch_summaries.push_back(thread_pool.submit([batch_values = std::move(batch_values), initial_conditions, step_size, days = this->days]() {
+                BatchModel model(batch_values);
+
+                std::array<CortisolCytokinesModel::State, BATCH_SIZE> initial_states;
+                initial_states.fill(initial_conditions);
+                BatchModel::State state = BatchModel::pack(initial_states);
+
+                SummaryObserver<BatchModel::State> summary;
+
+                CortisolCytokinesIntegrator::integrateFixed(model, state, 0.0, double(days), step_size, std::ref(summary));
+
+                std::array<SummaryObserver<>, BATCH_SIZE> lane_summaries;
+
+                for (std::size_t lane = 0; lane < BATCH_SIZE; lane++) {
+                    lane_summaries[lane].integral = BatchModel::unpack(summary.integral, lane);
+                    lane_summaries[lane].maximum = BatchModel::unpack(summary.maximum, lane);
+                    lane_summaries[lane].last = BatchModel::unpack(summary.last, lane);
+                    lane_summaries[lane].start_time = summary.start_time;
+                    lane_summaries[lane].last_time = summary.last_time;
+                    lane_summaries[lane].empty = summary.empty;
+                }
+
+                return lane_summaries;
+            }));
+        }
+    } else {
+        summaries.reserve(scenarios.size());
+
+        for (const auto &values : scenario_values) {
+            summaries.push_back(thread_pool.submit([values, initial_conditions, integrator, steady_state_tolerance, days = this->days]() {
+                CortisolCytokinesModel model(values);
+                CortisolCytokinesModel::State state = initial_conditions;
+                SummaryObserver<> summary;
+
+                if (steady_state_tolerance > 0) {
+                    integrator.integratePeriodic(model, state, 0.0, double(days), CortisolCytokinesModel::PERIOD, steady_state_tolerance, std::ref(summary));
+                } else {
+                    integrator.integrate(model, state, 0.0, double(days), std::ref(summary));
+                }
+
+                return summary;
+            }));
+        }
+    }
+
+    std::vector<std::string> header = {"Scenario"};
+    header.insert(header.end(), parameter_names.begin(), parameter_names.end());
+
+    for (const auto prefix : {"final", "mean", "max"}) {
+        for (const auto name : CortisolCytokinesModel::STATE_NAMES) {
+            header.push_back(fmt::format("{}_{}", prefix, name));
+        }
+    }
+
+    fmt::ostream file = fmt::output_file(output_path.string());
+    file.print("{}\n", fmt::join(header, ","));
+
+    std::array<SummaryObserver<>, BATCH_SIZE> batch_summary;
+
+    for (std::size_t i = 0; i < scenario_values.size(); i++) {
+        SummaryObserver<> summary;
+
+        if (step_size > 0) {
+            if (i % BATCH_SIZE == 0) {
+                batch_summary = batch_summaries[i / BATCH_SIZE].get();
+            }
+
+            summary = batch_summary[i % BATCH_SIZE];
+        } else {
+            summary = summaries[i].get();
+        }
+
+        file.print("{}", i);
+
+        for (const auto &name : parameter_names) {
+            file.print(",{}", scenario_values[i]->getParameter(name));
+        }
+
+        file.print(",{},{},{}\n", fmt::join(summary.last, ","), fmt::join(summary.mean(), ","), fmt::join(summary.maximum, ","));
+    }
+
+    file.close();
+
+    fmt::print("Sweep done.\n");
+}
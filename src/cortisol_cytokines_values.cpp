@@ -1,79 +1,79 @@
 #include "cortisol_cytokines_values.hpp"
 
-#include <fmt/color.h>
-#include <fmt/ranges.h>
-
-#include <cstdio>
+#include <array>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 
 #include "utilities.hpp"
 
-void CortisolCytokinesValues::setValues(const nlohmann::basic_json<> &json_file) {
-    try {
-        auto parameters = json_file.at("parameters");
-
-        k_6 = parameters.at("k_6");
-        k_6m = parameters.at("k_6M");
-        k_6tnf = parameters.at("k_6TNF");
-        k_8 = parameters.at("k_8");
-        k_8m = parameters.at("k_8M");
-        k_8tnf = parameters.at("k_8TNF");
-        k_10 = parameters.at("k_10");
-        k_10m = parameters.at("k_10M");
-        k_tnf = parameters.at("k_TNF");
-        k_tnfm = parameters.at("k_TNFM");
-        k_mtnf = parameters.at("k_MTNF");
-        q_il6 = parameters.at("q_IL6");
-        q_il8 = parameters.at("q_IL8");
-        q_il10 = parameters.at("q_IL10");
-        q_tnf = parameters.at("q_TNF");
-        n_106 = parameters.at("n_106");
-        n_610 = parameters.at("n_610");
-        n_66 = parameters.at("n_66");
-        n_6tnf = parameters.at("n_6TNF");
-        n_tnf6 = parameters.at("n_TNF6");
-        n_810 = parameters.at("n_810");
-        n_8tnf = parameters.at("n_8TNF");
-        n_m10 = parameters.at("n_M10");
-        n_tnf10 = parameters.at("n_TNF10");
-        n_mtnf = parameters.at("n_MTNF");
-        h_106 = parameters.at("h_106");
-        h_610 = parameters.at("h_610");
-        h_66 = parameters.at("h_66");
-        h_6tnf = parameters.at("h_6TNF");
-        h_tnf6 = parameters.at("h_TNF6");
-        h_810 = parameters.at("h_810");
-        h_8tnf = parameters.at("h_8TNF");
-        h_m10 = parameters.at("h_M10");
-        h_tnf10 = parameters.at("h_TNF10");
-        h_mtnf = parameters.at("h_MTNF");
-        k_106 = parameters.at("k_106");
-
-        ktc = parameters.at("ktc");
-        kmct = parameters.at("kmct");
-        kmtc = parameters.at("kmtc");
-        kcd = parameters.at("kcd");
-        klt = parameters.at("klt");
-        klt6 = parameters.at("klt6");
-        cmax = parameters.at("Cmax");
-
-        beta_a = parameters.at("beta_A");
-        k_a = parameters.at("k_A");
-        m_a = parameters.at("m_A");
-        mr_max = parameters.at("MR_max");
-        k_ma = parameters.at("k_MA");
-        k_mr = parameters.at("k_MR");
-        k_m = parameters.at("k_M");
-
-        gluc = Utilities::vectorToMap(parameters.at("glucose"));
-    } catch (const nlohmann::json::basic_json::out_of_range &exception) {
-        fmt::print(stderr, "Error reading attribute from file.\n");
-
-#ifndef NDEBUG
-        fmt::print(fg(fmt::color::dark_golden_rod) | fmt::emphasis::bold, "{}", exception.what());
-#endif
-
-        exit(513);
+const std::array<std::pair<std::string_view, double CortisolCytokinesValues::*>, CortisolCytokinesValues::PARAMETER_COUNT> CortisolCytokinesValues::PARAMETERS = {{
+    {"k_6", &CortisolCytokinesValues::k_6},
+    {"k_6M", &CortisolCytokinesValues::k_6m},
+    {"k_6TNF", &CortisolCytokinesValues::k_6tnf},
+    {"k_8", &CortisolCytokinesValues::k_8},
+    {"k_8M", &CortisolCytokinesValues::k_8m},
+    {"k_8TNF", &CortisolCytokinesValues::k_8tnf},
+    {"k_10", &CortisolCytokinesValues::k_10},
+    {"k_10M", &CortisolCytokinesValues::k_10m},
+    {"k_TNF", &CortisolCytokinesValues::k_tnf},
+    {"k_TNFM", &CortisolCytokinesValues::k_tnfm},
+    {"k_MTNF", &CortisolCytokinesValues::k_mtnf},
+    {"q_IL6", &CortisolCytokinesValues::q_il6},
+    {"q_IL8", &CortisolCytokinesValues::q_il8},
+    {"q_IL10", &CortisolCytokinesValues::q_il10},
+    {"q_TNF", &CortisolCytokinesValues::q_tnf},
+    {"n_106", &CortisolCytokinesValues::n_106},
+    {"n_610", &CortisolCytokinesValues::n_610},
+    {"n_66", &CortisolCytokinesValues::n_66},
+    {"n_6TNF", &CortisolCytokinesValues::n_6tnf},
+    {"n_TNF6", &CortisolCytokinesValues::n_tnf6},
+    {"n_810", &CortisolCytokinesValues::n_810},
+    {"n_8TNF", &CortisolCytokinesValues::n_8tnf},
+    {"n_M10", &CortisolCytokinesValues::n_m10},
+    {"n_TNF10", &CortisolCytokinesValues::n_tnf10},
+    {"n_MTNF", &CortisolCytokinesValues::n_mtnf},
+    {"h_106", &CortisolCytokinesValues::h_106},
+    {"h_610", &CortisolCytokinesValues::h_610},
+    {"h_66", &CortisolCytokinesValues::h_66},
+    {"h_6TNF", &CortisolCytokinesValues::h_6tnf},
+    {"h_TNF6", &CortisolCytokinesValues::h_tnf6},
+    {"h_810", &CortisolCytokinesValues::h_810},
+    {"h_8TNF", &CortisolCytokinesValues::h_8tnf},
+    {"h_M10", &CortisolCytokinesValues::h_m10},
+    {"h_TNF10", &CortisolCytokinesValues::h_tnf10},
+    {"h_MTNF", &CortisolCytokinesValues::h_mtnf},
+    {"k_106", &CortisolCytokinesValues::k_106},
+    {"ktc", &CortisolCytokinesValues::ktc},
+    {"kmct", &CortisolCytokinesValues::kmct},
+    {"kmtc", &CortisolCytokinesValues::kmtc},
+    {"kcd", &CortisolCytokinesValues::kcd},
+    {"klt", &CortisolCytokinesValues::klt},
+    {"klt6", &CortisolCytokinesValues::klt6},
+    {"Cmax", &CortisolCytokinesValues::cmax},
+    {"beta_A", &CortisolCytokinesValues::beta_a},
+    {"k_A", &CortisolCytokinesValues::k_a},
+    {"m_A", &CortisolCytokinesValues::m_a},
+    {"MR_max", &CortisolCytokinesValues::mr_max},
+    {"k_MA", &CortisolCytokinesValues::k_ma},
+    {"k_MR", &CortisolCytokinesValues::k_mr},
+    {"k_M", &CortisolCytokinesValues::k_m}
+}};
+
+void CortisolCytokinesValues::parseValues(const nlohmann::basic_json<> &json_file) {
+    const auto &parameters = json_file.at("parameters");
+
+    for (const auto &[name, member] : PARAMETERS) {
+        this->*member = parameters.at(name);
     }
+
+    gluc = Utilities::vectorToMap(parameters.at("glucose").get<std::vector<std::vector<double>>>());
+    gluc_interpolation = Utilities::LookupTable::parseInterpolation(parameters.value("glucose_interpolation", "nearest"));
+
+    updateDerivedValues();
 }
 
 void CortisolCytokinesValues::setDefaultValues() {
@@ -130,6 +130,7 @@ void CortisolCytokinesValues::setDefaultValues() {
     k_mr = 6;
     k_m = 1.414;
 
+    gluc_interpolation = Utilities::LookupTable::Interpolation::Nearest;
     gluc = {
         {0.01653410205714112, 41.24050289026066},
         {0.029155409994415665, 43.82924068400321},
@@ -241,4 +242,54 @@ void CortisolCytokinesValues::setDefaultValues() {
         {0.9923404319543595, 24.407322999834022},
         {1.0, 24.421449809076805}
     };
+
+    updateDerivedValues();
+}
+
+void CortisolCytokinesValues::setParameter(std::string_view name, double value) {
+    for (const auto &[parameter_name, member] : PARAMETERS) {
+        if (parameter_name == name) {
+            this->*member = value;
+
+            return;
+        }
+    }
+
+    throw std::out_of_range("Unknown parameter: " + std::string(name));
+}
+
+double CortisolCytokinesValues::getParameter(std::string_view name) const {
+    for (const auto &[parameter_name, member] : PARAMETERS) {
+        if (parameter_name == name) {
+            return this->*member;
+        }
+    }
+
+    throw std::out_of_range("Unknown parameter: " + std::string(name));
+}
+
+void CortisolCytokinesValues::updateDerivedValues() {
+    n_106_h_106 = pow(n_106, h_106);
+    n_610_h_610 = pow(n_610, h_610);
+    n_66_h_66 = pow(n_66, h_66);
+    n_6tnf_h_6tnf = pow(n_6tnf, h_6tnf);
+    n_tnf6_h_tnf6 = pow(n_tnf6, h_tnf6);
+    n_810_h_610_over_h_810 = pow(n_810, h_610) / pow(n_810, h_810);
+    n_8tnf_h_8tnf = pow(n_8tnf, h_8tnf);
+    n_m10_h_m10 = pow(n_m10, h_m10);
+    n_tnf10_h_tnf10 = pow(n_tnf10, h_tnf10);
+    n_mtnf_h_mtnf = pow(n_mtnf, h_mtnf);
+
+    h_106_power = Utilities::PowerFunction(h_106);
+    h_66_power = Utilities::PowerFunction(h_66);
+    h_6tnf_power = Utilities::PowerFunction(h_6tnf);
+    h_tnf6_power = Utilities::PowerFunction(h_tnf6);
+    h_810_power = Utilities::PowerFunction(h_810);
+    h_8tnf_power = Utilities::PowerFunction(h_8tnf);
+    h_m10_power = Utilities::PowerFunction(h_m10);
+    h_tnf10_power = Utilities::PowerFunction(h_tnf10);
+    h_mtnf_power = Utilities::PowerFunction(h_mtnf);
+    n_610_power = Utilities::PowerFunction(n_610);
+
+    gluc_table = Utilities::LookupTable(gluc, gluc_interpolation);
 }
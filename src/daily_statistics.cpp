@@ -0,0 +1,141 @@
+#include "daily_statistics.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace Utilities {
+    DailyStatistics::DailyStatistics(std::size_t state_size):
+        m_state_size(state_size),
+        m_columns(state_size * STATISTIC_COUNT),
+        m_integral(state_size),
+        m_square_integral(state_size),
+        m_minimum(state_size),
+        m_maximum(state_size),
+        m_previous_state(state_size),
+        m_boundary_state(state_size) {}
+
+    void DailyStatistics::startDay(double day) {
+        m_day = day;
+        m_duration = 0;
+
+        std::fill(m_integral.begin(), m_integral.end(), 0);
+        std::fill(m_square_integral.begin(), m_square_integral.end(), 0);
+        std::copy(m_previous_state.begin(), m_previous_state.end(), m_minimum.begin());
+        std::copy(m_previous_state.begin(), m_previous_state.end(), m_maximum.begin());
+    }
+
+    void DailyStatistics::include(std::span<const double> x) {
+        for (std::size_t i = 0; i < m_state_size; i++) {
+            m_minimum[i] = std::min(m_minimum[i], x[i]);
+            m_maximum[i] = std::max(m_maximum[i], x[i]);
+        }
+    }
+
+    // integrates the line from the previous sample to x within the current day
+    void DailyStatistics::accumulate(std::span<const double> x, double t) {
+        const double dt = t - m_previous_time;
+
+        for (std::size_t i = 0; i < m_state_size; i++) {
+            const double a = m_previous_state[i];
+            const double b = x[i];
+
+            m_integral[i] += dt * (a + b) / 2;
+            m_square_integral[i] += dt * (a * a + a * b + b * b) / 3;
+        }
+
+        m_duration += dt;
+        include(x);
+
+        std::copy(x.begin(), x.begin() + m_state_size, m_previous_state.begin());
+        m_previous_time = t;
+    }
+
+    void DailyStatistics::finishDay() {
+        // the last sample of a run often lands exactly on midnight, starting a day without any length
+        if (m_duration <= 0) {
+            return;
+        }
+
+        m_days.push_back(m_day);
+
+        for (std::size_t i = 0; i < m_state_size; i++) {
+            const double mean = m_integral[i] / m_duration;
+
+            m_columns[i * STATISTIC_COUNT + Mean].push_back(mean);
+            m_columns[i * STATISTIC_COUNT + Minimum].push_back(m_minimum[i]);
+            m_columns[i * STATISTIC_COUNT + Maximum].push_back(m_maximum[i]);
+            m_columns[i * STATISTIC_COUNT + Integral].push_back(m_integral[i]);
+            m_columns[i * STATISTIC_COUNT + Variance].push_back(std::max(0.0, m_square_integral[i] / m_duration - mean * mean));
+        }
+    }
+
+    void DailyStatistics::operator()(std::span<const double> x, double t) {
+        if (!m_started) {
+            m_started = true;
+            std::copy(x.begin(), x.begin() + m_state_size, m_previous_state.begin());
+            m_previous_time = t;
+            startDay(std::floor(t));
+
+            return;
+        }
+
+        // every midnight between the previous sample and this one closes a day, with the state at midnight
+        // interpolated between both samples starting the next
+        while (t >= m_day + 1) {
+            const double midnight = m_day + 1;
+            const double fraction = (midnight - m_previous_time) / (t - m_previous_time);
+
+            for (std::size_t i = 0; i < m_state_size; i++) {
+                m_boundary_state[i] = m_previous_state[i] + fraction * (x[i] - m_previous_state[i]);
+            }
+
+            accumulate(m_boundary_state, midnight);
+            finishDay();
+            startDay(midnight);
+        }
+
+        accumulate(x, t);
+    }
+
+    void DailyStatistics::finish() {
+        if (m_started) {
+            finishDay();
+            m_started = false;
+        }
+    }
+
+    std::size_t DailyStatistics::size() const {
+        return m_days.size();
+    }
+
+    const std::vector<double> &DailyStatistics::days() const {
+        return m_days;
+    }
+
+    const std::vector<double> &DailyStatistics::column(std::size_t variable, Statistic statistic) const {
+        return m_columns[variable * STATISTIC_COUNT + statistic];
+    }
+
+    std::vector<std::span<const double>> DailyStatistics::columns() const {
+        std::vector<std::span<const double>> columns = {m_days};
+        columns.insert(columns.end(), m_columns.begin(), m_columns.end());
+
+        return columns;
+    }
+
+    std::vector<std::string> DailyStatistics::header(const std::vector<std::string> &variable_names) const {
+        std::vector<std::string> header = {"Day"};
+
+        for (const auto &name : variable_names) {
+            for (const auto statistic : STATISTIC_NAMES) {
+                header.push_back(name + " " + statistic);
+            }
+        }
+
+        return header;
+    }
+}  // namespace Utilities
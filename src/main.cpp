@@ -8,22 +8,85 @@
 #include <fmt/base.h>
 #include <fmt/color.h>
 
+#include <cstddef>
+#include <exception>
 #include <filesystem>
+#include <iostream>
+#include <nlohmann/json.hpp>
+#include <optional>
 #include <stdexcept>
 #include <string>
 #include <vector>
 
+#include "cortisol_cytokines_configuration.hpp"
+#include "cortisol_cytokines_integrator.hpp"
+#include "cortisol_cytokines_server.hpp"
 #include "cortisol_cytokines_simulation.hpp"
+#include "cortisol_cytokines_sweep.hpp"
 #include "utilities.hpp"
 
+#ifdef ENABLE_PLOTTING
+    #include "cortisol_cytokines_plots.hpp"
+#endif
+
+// the simulation, the sweep and the server throw when their configuration can't be used, anything else is
+// rethrown
+[[noreturn]] static void exitOnConfigurationError(const std::exception_ptr &exception_pointer) {
+    try {
+        std::rethrow_exception(exception_pointer);
+    } catch (const CortisolCytokinesConfiguration::FileError &exception) {
+        fmt::print(stderr, fg(fmt::color::dark_red) | fmt::emphasis::bold, "{}\n", exception.what());
+
+#ifndef NDEBUG
+        try {
+            std::rethrow_if_nested(exception);
+        } catch (const std::exception &nested_exception) {
+            fmt::print(stderr, fg(fmt::color::dark_golden_rod) | fmt::emphasis::bold, "{}", nested_exception.what());
+        }
+#endif
+
+        exit(512);
+    } catch (const nlohmann::json::exception &exception) {
+        fmt::print(stderr, fg(fmt::color::dark_red) | fmt::emphasis::bold, "Error reading attribute from file.\n");
+
+#ifndef NDEBUG
+        fmt::print(stderr, fg(fmt::color::dark_golden_rod) | fmt::emphasis::bold, "{}", exception.what());
+#endif
+
+        exit(513);
+    } catch (const std::logic_error &exception) {
+        // unknown parameters are std::out_of_range and invalid values std::invalid_argument
+        fmt::print(stderr, fg(fmt::color::dark_red) | fmt::emphasis::bold, "{}\n", exception.what());
+
+        exit(513);
+    }
+}
+
 int main(int argc, char *argv[]) {
     std::filesystem::path input_path;
     int days = 36500;
     bool plot = true;
     bool csv = true;
+    bool stream = false;
+    bool binary = false;
+    Utilities::BinarySink::Precision binary_precision = Utilities::BinarySink::Precision::Double;
+    std::size_t block_size = 16384;
+    std::optional<int> csv_precision;
+    bool compress = false;
+    bool daily_statistics = false;
+    CortisolCytokinesIntegrator::Overrides integrator_overrides;
+    std::optional<double> steady_state_tolerance;
+    std::filesystem::path checkpoint_path;
+    double checkpoint_interval = 365;
+    bool resume = false;
+    std::filesystem::path metrics_path;
+    std::filesystem::path sweep_path;
+    std::size_t thread_count = 0;
+    bool serve = false;
 
 #ifndef NDEBUG
-    fmt::print(fg(fmt::color::dark_golden_rod) | fmt::emphasis::bold, "Profiling enabled!\n\n");
+    // stdout carries the answers of --serve
+    fmt::print(stderr, fg(fmt::color::dark_golden_rod) | fmt::emphasis::bold, "Profiling enabled!\n\n");
 #endif
 
     for (int i = 1; i < argc; i++) {
@@ -88,6 +151,305 @@ int main(int argc, char *argv[]) {
                 )
             ) {
                 csv = false;
+            } else if (
+                auto stream_return = Utilities::readParameter<bool>(
+                    {"--stream"},
+                    argv[i],
+                    (char *) "1",
+                    [](std::string input) -> bool {
+                        return true;
+                    }
+                )
+            ) {
+                stream = true;
+            } else if (
+                auto binary_return = Utilities::readParameter<bool>(
+                    {"--binary"},
+                    argv[i],
+                    (char *) "1",
+                    [](std::string input) -> bool {
+                        return true;
+                    }
+                )
+            ) {
+                binary = true;
+            } else if (
+                auto float32_return = Utilities::readParameter<bool>(
+                    {"--float32"},
+                    argv[i],
+                    (char *) "1",
+                    [](std::string input) -> bool {
+                        return true;
+                    }
+                )
+            ) {
+                binary = true;
+                binary_precision = Utilities::BinarySink::Precision::Single;
+            } else if (
+                auto csv_precision_return = Utilities::readParameter<int>(
+                    {"--csv-precision"},
+                    argv[i],
+                    argv[i + 1],
+                    [](std::string input) -> int {
+                        int csv_precision = std::stoi(input);
+
+                        // 17 significant digits are enough for any double
+                        if (csv_precision < 1 || csv_precision > 17) {
+                            fmt::print(stderr, fg(fmt::color::dark_red) | fmt::emphasis::bold, "Invalid CSV precision: {}\n", csv_precision);
+                            exit(3);
+                        }
+
+                        return csv_precision;
+                    }
+                )
+            ) {
+                csv_precision = csv_precision_return.value();
+                i++;
+            } else if (
+                auto compress_return = Utilities::readParameter<bool>(
+                    {"--compress"},
+                    argv[i],
+                    (char *) "1",
+                    [](std::string input) -> bool {
+                        if (!Utilities::COMPRESSION_SUPPORTED) {
+                            fmt::print(stderr, fg(fmt::color::dark_red) | fmt::emphasis::bold, "--compress requires building with ENABLE_COMPRESSION\n");
+                            exit(3);
+                        }
+
+                        return true;
+                    }
+                )
+            ) {
+                compress = true;
+            } else if (
+                auto daily_statistics_return = Utilities::readParameter<bool>(
+                    {"--daily-statistics"},
+                    argv[i],
+                    (char *) "1",
+                    [](std::string input) -> bool {
+                        return true;
+                    }
+                )
+            ) {
+                daily_statistics = true;
+            } else if (
+                auto block_size_return = Utilities::readParameter<std::size_t>(
+                    {"--block-size"},
+                    argv[i],
+                    argv[i + 1],
+                    [](std::string input) -> std::size_t {
+                        long long block_size = std::stoll(input);
+
+                        if (block_size <= 0) {
+                            fmt::print(stderr, fg(fmt::color::dark_red) | fmt::emphasis::bold, "Invalid block size: {}\n", block_size);
+                            exit(3);
+                        }
+
+                        return block_size;
+                    }
+                )
+            ) {
+                block_size = block_size_return.value();
+                i++;
+            } else if (
+                auto output_interval_return = Utilities::readParameter<double>(
+                    {"--output-interval"},
+                    argv[i],
+                    argv[i + 1],
+                    [](std::string input) -> double {
+                        double output_interval = std::stod(input);
+
+                        if (!(output_interval > 0)) {
+                            fmt::print(stderr, fg(fmt::color::dark_red) | fmt::emphasis::bold, "Invalid output interval: {}\n", output_interval);
+                            exit(3);
+                        }
+
+                        // given in minutes, the model runs in days
+                        return output_interval / (24 * 60);
+                    }
+                )
+            ) {
+                integrator_overrides.output_interval = output_interval_return.value();
+                i++;
+            } else if (
+                auto solver_return = Utilities::readParameter<CortisolCytokinesIntegrator::Solver>(
+                    {"--solver"},
+                    argv[i],
+                    argv[i + 1],
+                    [](std::string input) -> CortisolCytokinesIntegrator::Solver {
+                        try {
+                            return CortisolCytokinesIntegrator::parseSolver(input);
+                        } catch (const std::invalid_argument &exception) {
+                            fmt::print(stderr, fg(fmt::color::dark_red) | fmt::emphasis::bold, "Invalid solver: {}\n", input);
+                            exit(3);
+                        }
+                    }
+                )
+            ) {
+                integrator_overrides.solver = solver_return.value();
+                i++;
+            } else if (
+                auto absolute_tolerance_return = Utilities::readParameter<double>(
+                    {"--abs-tol"},
+                    argv[i],
+                    argv[i + 1],
+                    [](std::string input) -> double {
+                        double tolerance = std::stod(input);
+
+                        if (!(tolerance > 0)) {
+                            fmt::print(stderr, fg(fmt::color::dark_red) | fmt::emphasis::bold, "Invalid absolute tolerance: {}\n", tolerance);
+                            exit(3);
+                        }
+
+                        return tolerance;
+                    }
+                )
+            ) {
+                integrator_overrides.absolute_tolerance = absolute_tolerance_return.value();
+                i++;
+            } else if (
+                auto relative_tolerance_return = Utilities::readParameter<double>(
+                    {"--rel-tol"},
+                    argv[i],
+                    argv[i + 1],
+                    [](std::string input) -> double {
+                        double tolerance = std::stod(input);
+
+                        if (!(tolerance > 0)) {
+                            fmt::print(stderr, fg(fmt::color::dark_red) | fmt::emphasis::bold, "Invalid relative tolerance: {}\n", tolerance);
+                            exit(3);
+                        }
+
+                        return tolerance;
+                    }
+                )
+            ) {
+                integrator_overrides.relative_tolerance = relative_tolerance_return.value();
+                i++;
+            } else if (
+                auto steady_state_return = Utilities::readParameter<double>(
+                    {"--steady-state"},
+                    argv[i],
+                    argv[i + 1],
+                    [](std::string input) -> double {
+                        double tolerance = std::stod(input);
+
+                        if (!(tolerance > 0)) {
+                            fmt::print(stderr, fg(fmt::color::dark_red) | fmt::emphasis::bold, "Invalid steady state tolerance: {}\n", tolerance);
+                            exit(3);
+                        }
+
+                        return tolerance;
+                    }
+                )
+            ) {
+                steady_state_tolerance = steady_state_return.value();
+                i++;
+            } else if (
+                auto checkpoint_path_return = Utilities::readParameter<std::filesystem::path>(
+                    {"--checkpoint"},
+                    argv[i],
+                    argv[i + 1],
+                    [](std::string input) -> std::filesystem::path {
+                        return input;
+                    }
+                )
+            ) {
+                // checkpoints are only written while streaming, since they resume by appending to the output
+                stream = true;
+                checkpoint_path = checkpoint_path_return.value();
+                i++;
+            } else if (
+                auto checkpoint_interval_return = Utilities::readParameter<double>(
+                    {"--checkpoint-interval"},
+                    argv[i],
+                    argv[i + 1],
+                    [](std::string input) -> double {
+                        double checkpoint_interval = std::stod(input);
+
+                        if (!(checkpoint_interval > 0)) {
+                            fmt::print(stderr, fg(fmt::color::dark_red) | fmt::emphasis::bold, "Invalid checkpoint interval: {}\n", checkpoint_interval);
+                            exit(3);
+                        }
+
+                        return checkpoint_interval;
+                    }
+                )
+            ) {
+                checkpoint_interval = checkpoint_interval_return.value();
+                i++;
+            } else if (
+                auto resume_return = Utilities::readParameter<bool>(
+                    {"--resume"},
+                    argv[i],
+                    (char *) "1",
+                    [](std::string input) -> bool {
+                        return true;
+                    }
+                )
+            ) {
+                resume = true;
+            } else if (
+                auto serve_return = Utilities::readParameter<bool>(
+                    {"--serve"},
+                    argv[i],
+                    (char *) "1",
+                    [](std::string input) -> bool {
+                        return true;
+                    }
+                )
+            ) {
+                serve = true;
+            } else if (
+                auto metrics_path_return = Utilities::readParameter<std::filesystem::path>(
+                    {"--metrics"},
+                    argv[i],
+                    argv[i + 1],
+                    [](std::string input) -> std::filesystem::path {
+                        return input;
+                    }
+                )
+            ) {
+                metrics_path = metrics_path_return.value();
+                i++;
+            } else if (
+                auto sweep_path_return = Utilities::readParameter<std::filesystem::path>(
+                    {"-s", "--sweep"},
+                    argv[i],
+                    argv[i + 1],
+                    [](std::string input) -> std::filesystem::path {
+                        std::filesystem::path sweep_path = input;
+
+                        if (!std::filesystem::is_regular_file(sweep_path)) {
+                            fmt::print(stderr, fg(fmt::color::dark_red) | fmt::emphasis::bold, "Invalid file path: {}\n", input);
+                            exit(3);
+                        }
+
+                        return sweep_path;
+                    }
+                )
+            ) {
+                sweep_path = sweep_path_return.value();
+                i++;
+            } else if (
+                auto thread_count_return = Utilities::readParameter<std::size_t>(
+                    {"-t", "--threads"},
+                    argv[i],
+                    argv[i + 1],
+                    [](std::string input) -> std::size_t {
+                        long long thread_count = std::stoll(input);
+
+                        if (thread_count < 0) {
+                            fmt::print(stderr, fg(fmt::color::dark_red) | fmt::emphasis::bold, "Invalid amount of threads: {}\n", thread_count);
+                            exit(3);
+                        }
+
+                        return thread_count;
+                    }
+                )
+            ) {
+                thread_count = thread_count_return.value();
+                i++;
             } else {
                 fmt::print(stderr, fg(fmt::color::dark_red) | fmt::emphasis::bold, "Unknown parameter: {}\n", argv[i]);
                 exit(1);
@@ -98,17 +460,80 @@ int main(int argc, char *argv[]) {
         }
     }
 
+    if (resume && checkpoint_path.empty()) {
+        fmt::print(stderr, fg(fmt::color::dark_red) | fmt::emphasis::bold, "--resume requires the --checkpoint to resume from\n");
+        exit(3);
+    }
+
+    if (serve) {
+        // jobs come in through stdin and the results go out through stdout, see CortisolCytokinesServer
+        std::ios::sync_with_stdio(false);
+
+        CortisolCytokinesServer cortisol_cytokines_server(input_path, days, thread_count, integrator_overrides, steady_state_tolerance);
+
+        try {
+            cortisol_cytokines_server.startServer(std::cin, std::cout);
+        } catch (...) {
+            exitOnConfigurationError(std::current_exception());
+        }
+
+        return 0;
+    }
+
+    if (!sweep_path.empty()) {
+        CortisolCytokinesSweep cortisol_cytokines_sweep(sweep_path, days, thread_count, integrator_overrides, steady_state_tolerance);
+
+        try {
+            cortisol_cytokines_sweep.startSweep();
+        } catch (...) {
+            exitOnConfigurationError(std::current_exception());
+        }
+
+        return 0;
+    }
+
     CortisolCytokinesSimulation cortisol_cytokines_simulation;
 
     cortisol_cytokines_simulation.setDays(days);
     cortisol_cytokines_simulation.setPlot(plot);
+
+    // headless builds skip the figures
+#ifdef ENABLE_PLOTTING
+    cortisol_cytokines_simulation.setPlotter(CortisolCytokinesPlots::plotSimulation);
+#endif
     cortisol_cytokines_simulation.setCsv(csv);
+    cortisol_cytokines_simulation.setStream(stream);
+    cortisol_cytokines_simulation.setBinary(binary);
+    cortisol_cytokines_simulation.setBinaryPrecision(binary_precision);
+
+    if (csv_precision) {
+        cortisol_cytokines_simulation.setCsvPrecision(*csv_precision);
+    }
+
+    cortisol_cytokines_simulation.setCompress(compress);
+    cortisol_cytokines_simulation.setDailyStatistics(daily_statistics);
+    cortisol_cytokines_simulation.setBlockSize(block_size);
+
+    cortisol_cytokines_simulation.setIntegratorOverrides(integrator_overrides);
+
+    if (steady_state_tolerance) {
+        cortisol_cytokines_simulation.setSteadyStateTolerance(*steady_state_tolerance);
+    }
+
+    cortisol_cytokines_simulation.setCheckpointPath(checkpoint_path);
+    cortisol_cytokines_simulation.setCheckpointInterval(checkpoint_interval);
+    cortisol_cytokines_simulation.setResume(resume);
+    cortisol_cytokines_simulation.setMetricsPath(metrics_path);
 
     if (!input_path.empty()) {
         cortisol_cytokines_simulation.setInputPath(input_path);
     }
 
-    cortisol_cytokines_simulation.startSimulation();
+    try {
+        cortisol_cytokines_simulation.startSimulation();
+    } catch (...) {
+        exitOnConfigurationError(std::current_exception());
+    }
 
     return 0;
 }
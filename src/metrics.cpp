@@ -0,0 +1,88 @@
+#include "metrics.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <nlohmann/json.hpp>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#ifdef _WIN32
+#include <windows.h>
+// after windows.h
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace Utilities {
+    void Metrics::startPhase(const std::string &name) {
+        this->running_phases[name] = Clock::now();
+    }
+
+    void Metrics::stopPhase(const std::string &name) {
+        const auto end = Clock::now();
+        const auto phase = this->running_phases.find(name);
+
+        if (phase == this->running_phases.end()) {
+            return;
+        }
+
+        const double seconds = std::chrono::duration<double>(end - phase->second).count();
+
+        this->phases[name] = this->phases.value(name, 0.0) + seconds;
+        this->running_phases.erase(phase);
+    }
+
+    void Metrics::set(const std::string &key, nlohmann::ordered_json value) {
+        this->report[key] = std::move(value);
+    }
+
+    void Metrics::write(const std::filesystem::path &file_path) const {
+        nlohmann::ordered_json output = this->report;
+        const auto peak_rss = peakResidentSetSize();
+
+        output["phases"] = this->phases;
+        output["peak_rss_bytes"] = peak_rss ? nlohmann::ordered_json(*peak_rss) : nlohmann::ordered_json(nullptr);
+
+        if (file_path.has_parent_path()) {
+            std::filesystem::create_directories(file_path.parent_path());
+        }
+
+        std::ofstream file(file_path);
+        file << output.dump(4) << '\n';
+
+        if (!file) {
+            throw std::runtime_error("Couldn't write " + file_path.string());
+        }
+    }
+
+    std::optional<std::uintmax_t> Metrics::peakResidentSetSize() {
+#ifdef _WIN32
+        PROCESS_MEMORY_COUNTERS counters;
+
+        if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+            return std::nullopt;
+        }
+
+        return std::uintmax_t(counters.PeakWorkingSetSize);
+#else
+        rusage usage;
+
+        if (getrusage(RUSAGE_SELF, &usage) != 0) {
+            return std::nullopt;
+        }
+
+#ifdef __APPLE__
+        // bytes on macos
+        return std::uintmax_t(usage.ru_maxrss);
+#else
+        // kilobytes on linux
+        return std::uintmax_t(usage.ru_maxrss) * 1024;
+#endif
+#endif
+    }
+}  // namespace Utilities
@@ -0,0 +1,149 @@
+#include "output_stream.hpp"
+
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#ifdef ENABLE_COMPRESSION
+    #include <zlib.h>
+
+    #include <vector>
+#endif
+
+namespace Utilities {
+    class FileOutputStream : public OutputStream {
+        private:
+            std::filesystem::path file_path;
+            std::ofstream file;
+
+            void check() const {
+                if (!file) {
+                    throw std::runtime_error("Couldn't write " + file_path.string());
+                }
+            }
+
+        public:
+            FileOutputStream(const std::filesystem::path &file_path, bool append):
+                file_path(file_path),
+                file(file_path, append ? std::ios::binary | std::ios::app : std::ios::binary | std::ios::trunc) {
+                if (!file) {
+                    throw std::runtime_error("Couldn't open " + file_path.string());
+                }
+            }
+
+            void write(const char *data, std::size_t size) override {
+                file.write(data, std::streamsize(size));
+                check();
+            }
+
+            void flush() override {
+                file.flush();
+                check();
+            }
+
+            void close() override {
+                file.close();
+                check();
+            }
+    };
+
+#ifdef ENABLE_COMPRESSION
+    // every flush ends the current gzip member and the next write starts another one, concatenated members
+    // are still a single valid gzip file, which is what lets a compressed output be resumed
+    class GzipOutputStream : public OutputStream {
+        private:
+            // the fastest level, anything higher can't keep up with the CSV writer
+            static constexpr int LEVEL = 1;
+
+            std::filesystem::path file_path;
+            std::ofstream file;
+            z_stream stream = {};
+            std::vector<char> compressed = std::vector<char>(1 << 18);
+            bool member_open = false;
+
+            void deflateInput(const char *data, std::size_t size, int mode) {
+                stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+                stream.avail_in = uInt(size);
+
+                int result;
+
+                do {
+                    stream.next_out = reinterpret_cast<Bytef *>(compressed.data());
+                    stream.avail_out = uInt(compressed.size());
+
+                    result = deflate(&stream, mode);
+
+                    if (result == Z_STREAM_ERROR) {
+                        throw std::runtime_error("Compression error");
+                    }
+
+                    file.write(compressed.data(), std::streamsize(compressed.size() - stream.avail_out));
+                    check();
+                } while (stream.avail_out == 0 || (mode == Z_FINISH && result != Z_STREAM_END));
+            }
+
+            void check() const {
+                if (!file) {
+                    throw std::runtime_error("Couldn't write " + file_path.string());
+                }
+            }
+
+        public:
+            GzipOutputStream(const std::filesystem::path &file_path, bool append):
+                file_path(file_path),
+                file(file_path, append ? std::ios::binary | std::ios::app : std::ios::binary | std::ios::trunc) {
+                if (!file) {
+                    throw std::runtime_error("Couldn't open " + file_path.string());
+                }
+
+                // 16 added to the window bits selects the gzip format instead of raw zlib
+                if (deflateInit2(&stream, LEVEL, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+                    throw std::runtime_error("Couldn't initialize the compression of " + file_path.string());
+                }
+            }
+
+            ~GzipOutputStream() override {
+                deflateEnd(&stream);
+            }
+
+            void write(const char *data, std::size_t size) override {
+                member_open = true;
+
+                deflateInput(data, size, Z_NO_FLUSH);
+            }
+
+            void flush() override {
+                if (member_open) {
+                    deflateInput(nullptr, 0, Z_FINISH);
+                    deflateReset(&stream);
+
+                    member_open = false;
+                }
+
+                file.flush();
+                check();
+            }
+
+            void close() override {
+                flush();
+                file.close();
+                check();
+            }
+    };
+#endif
+
+    std::unique_ptr<OutputStream> openOutputStream(const std::filesystem::path &file_path, bool append) {
+        if (file_path.extension() == ".gz") {
+#ifdef ENABLE_COMPRESSION
+            return std::make_unique<GzipOutputStream>(file_path, append);
+#else
+            throw std::runtime_error("Can't write " + file_path.string() + ", compression wasn't enabled in this build");
+#endif
+        }
+
+        return std::make_unique<FileOutputStream>(file_path, append);
+    }
+}  // namespace Utilities
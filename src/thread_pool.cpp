@@ -0,0 +1,58 @@
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+
+namespace Utilities {
+    ThreadPool::ThreadPool(std::size_t thread_count) {
+        if (thread_count == 0) {
+            thread_count = std::max(1u, std::thread::hardware_concurrency());
+        }
+
+        workers.reserve(thread_count);
+
+        for (std::size_t i = 0; i < thread_count; i++) {
+            workers.emplace_back(&ThreadPool::work, this);
+        }
+    }
+
+    ThreadPool::~ThreadPool() {
+        {
+            std::scoped_lock lock(jobs_mutex);
+            stopping = true;
+        }
+
+        jobs_available.notify_all();
+
+        // std::jthread joins on destruction
+        workers.clear();
+    }
+
+    std::size_t ThreadPool::size() const {
+        return workers.size();
+    }
+
+    void ThreadPool::work() {
+        while (true) {
+            std::move_only_function<void()> job;
+
+            {
+                std::unique_lock lock(jobs_mutex);
+                jobs_available.wait(lock, [this] {
+                    return stopping || !jobs.empty();
+                });
+
+                if (jobs.empty()) {
+                    return;
+                }
+
+                job = std::move(jobs.front());
+                jobs.pop();
+            }
+
+            job();
+        }
+    }
+}  // namespace Utilities
@@ -0,0 +1,33 @@
+#include "trajectory.hpp"
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+Trajectory::Trajectory(std::size_t state_size): m_states(state_size) {}
+
+void Trajectory::reserve(std::size_t samples) {
+    m_times.reserve(samples);
+
+    for (auto &column : m_states) {
+        column.reserve(samples);
+    }
+}
+
+void Trajectory::clear() {
+    m_times.clear();
+
+    for (auto &column : m_states) {
+        column.clear();
+    }
+}
+
+std::vector<std::span<const double>> Trajectory::columns() const {
+    std::vector<std::span<const double>> columns = {m_times};
+
+    for (const auto &column : m_states) {
+        columns.push_back(column);
+    }
+
+    return columns;
+}
@@ -1,10 +1,14 @@
 #include "utilities.hpp"
 
 #include <fmt/base.h>
-#include <fmt/os.h>
-#include <fmt/ranges.h>
 
+#include <bit>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
 #include <filesystem>
+#include <string_view>
+#include <type_traits>
 
 #ifndef NDEBUG
     #include <fmt/chrono.h>
@@ -14,53 +18,197 @@
 #endif
 
 namespace Utilities {
-    std::map<double, std::vector<double>> combineStateWithTimeMap(const std::vector<std::vector<double>> &states, const std::vector<double> &times) {
-        if (states.size() != times.size()) {
-            throw states.size() - times.size();
+    LookupTable::Interpolation LookupTable::parseInterpolation(const std::string &name) {
+        if (name == "nearest") {
+            return Interpolation::Nearest;
+        } else if (name == "linear") {
+            return Interpolation::Linear;
+        } else if (name == "cubic") {
+            return Interpolation::Cubic;
         }
 
-        std::map<double, std::vector<double>> mapped_states;
+        throw std::invalid_argument("Unknown interpolation: " + name);
+    }
 
-        for (std::size_t i = 0; i < states.size(); i++) {
-            mapped_states[times[i]] = states[i];
+    LookupTable::LookupTable(const std::map<double, double> &points, Interpolation interpolation, std::size_t resolution): m_interpolation(interpolation) {
+        if (points.empty()) {
+            throw std::invalid_argument("Lookup table without points");
         }
 
-        return mapped_states;
-    }
+        const std::vector<std::pair<double, double>> sorted_points(points.begin(), points.end());
+        const std::size_t point_count = sorted_points.size();
+
+        m_start = sorted_points.front().first;
+        const double step = (sorted_points.back().first - m_start) / double(resolution - 1);
+        m_inverse_step = step > 0 ? 1 / step : 0;
+
+        if (interpolation == Interpolation::Nearest) {
+            m_keys.reserve(point_count);
+            m_points.reserve(point_count);
+
+            for (const auto &[key, value] : sorted_points) {
+                m_keys.push_back(key);
+                m_points.push_back(value);
+            }
+
+            if (point_count == 1 || step == 0) {
+                m_cells.assign(2, 0);
+
+                return;
+            }
+
+            m_cells.resize(resolution);
+
+            std::size_t index = 0;
+
+            for (std::size_t i = 0; i < resolution; i++) {
+                const double key = m_start + double(i) * step;
+
+                while (index < point_count - 1 && m_keys[index + 1] <= key) {
+                    index++;
+                }
 
-    std::vector<std::vector<double>> combineStateWithTimeVector(const std::vector<std::vector<double>> &states, const std::vector<double> &times) {
-        if (states.size() != times.size()) {
-            throw states.size() - times.size();
+                m_cells[i] = index;
+            }
+
+            return;
+        }
+
+        if (point_count == 1 || step == 0) {
+            m_values.assign(2, sorted_points.front().second);
+
+            return;
         }
 
-        std::vector<std::vector<double>> joined_vector;
+        // fritsch-carlson tangents, only used by the cubic interpolation
+        std::vector<double> tangents(point_count, 0);
+
+        if (interpolation == Interpolation::Cubic) {
+            std::vector<double> slopes(point_count - 1);
 
-        for (std::size_t i = 0; i < states.size(); i++) {
-            std::vector<double> joined_line = {times[i]};
-            joined_line.insert(joined_line.end(), states[i].begin(), states[i].end());
+            for (std::size_t i = 0; i < point_count - 1; i++) {
+                slopes[i] = (sorted_points[i + 1].second - sorted_points[i].second) / (sorted_points[i + 1].first - sorted_points[i].first);
+            }
+
+            tangents.front() = slopes.front();
+            tangents.back() = slopes.back();
+
+            for (std::size_t i = 1; i < point_count - 1; i++) {
+                if (slopes[i - 1] * slopes[i] > 0) {
+                    const double left_width = sorted_points[i].first - sorted_points[i - 1].first;
+                    const double right_width = sorted_points[i + 1].first - sorted_points[i].first;
+                    const double left_weight = 2 * right_width + left_width;
+                    const double right_weight = right_width + 2 * left_width;
 
-            joined_vector.push_back(joined_line);
+                    tangents[i] = (left_weight + right_weight) / (left_weight / slopes[i - 1] + right_weight / slopes[i]);
+                }
+            }
         }
 
-        return joined_vector;
+        m_values.resize(resolution);
+
+        std::size_t segment = 0;
+
+        for (std::size_t i = 0; i < resolution; i++) {
+            const double key = i == resolution - 1 ? sorted_points.back().first : m_start + double(i) * step;
+
+            while (segment < point_count - 2 && sorted_points[segment + 1].first < key) {
+                segment++;
+            }
+
+            const auto &[left_key, left_value] = sorted_points[segment];
+            const auto &[right_key, right_value] = sorted_points[segment + 1];
+            const double width = right_key - left_key;
+            const double t = std::clamp((key - left_key) / width, 0.0, 1.0);
+
+            switch (interpolation) {
+                case Interpolation::Nearest:
+                    break;
+                case Interpolation::Linear:
+                    m_values[i] = left_value + t * (right_value - left_value);
+                    break;
+                case Interpolation::Cubic: {
+                    const double t2 = t * t;
+                    const double t3 = t2 * t;
+
+                    m_values[i] = (2 * t3 - 3 * t2 + 1) * left_value +
+                                  (t3 - 2 * t2 + t) * width * tangents[segment] +
+                                  (-2 * t3 + 3 * t2) * right_value +
+                                  (t3 - t2) * width * tangents[segment + 1];
+                    break;
+                }
+            }
+        }
     }
 
-    std::map<double, double> vectorToMap(std::vector<std::vector<double>> vector) {
+    std::map<double, double> vectorToMap(const std::vector<std::vector<double>> &vector) {
         std::map<double, double> map;
 
-        for (auto values : vector) {
+        for (const auto &values : vector) {
+            if (values.size() != 2) {
+                throw std::invalid_argument("Every point of the series needs exactly a key and a value");
+            }
+
             map.insert(std::pair(values[0], values[1]));
         }
 
         return map;
     }
 
-    IntegralObserver::IntegralObserver(std::vector<std::vector<double>> &states, std::vector<double> &times): m_states(states), m_times(times) {}
+    std::pair<std::vector<double>, std::vector<double>> decimateMinMax(std::span<const double> x, std::span<const double> y, std::size_t bucket_count) {
+        if (x.size() != y.size()) {
+            throw std::invalid_argument("Series with different lengths");
+        }
+
+        if (x.size() <= 2 * bucket_count + 2 || x.back() <= x.front()) {
+            return {std::vector<double>(x.begin(), x.end()), std::vector<double>(y.begin(), y.end())};
+        }
+
+        std::pair<std::vector<double>, std::vector<double>> decimated;
+        auto &[decimated_x, decimated_y] = decimated;
+        decimated_x.reserve(2 * bucket_count + 2);
+        decimated_y.reserve(2 * bucket_count + 2);
+
+        decimated_x.push_back(x.front());
+        decimated_y.push_back(y.front());
+
+        const double buckets_per_x = double(bucket_count) / (x.back() - x.front());
+        std::size_t index = 1;
+
+        // the last point is added on it's own
+        while (index < x.size() - 1) {
+            const std::size_t bucket = std::min(std::size_t((x[index] - x.front()) * buckets_per_x), bucket_count - 1);
+            std::size_t minimum = index;
+            std::size_t maximum = index;
+
+            for (index++; index < x.size() - 1 && std::min(std::size_t((x[index] - x.front()) * buckets_per_x), bucket_count - 1) == bucket; index++) {
+                if (y[index] < y[minimum]) {
+                    minimum = index;
+                } else if (y[index] > y[maximum]) {
+                    maximum = index;
+                }
+            }
+
+            for (const std::size_t extreme : {std::min(minimum, maximum), std::max(minimum, maximum)}) {
+                if (decimated_x.back() != x[extreme] || decimated_y.back() != y[extreme]) {
+                    decimated_x.push_back(x[extreme]);
+                    decimated_y.push_back(y[extreme]);
+                }
+            }
+        }
+
+        decimated_x.push_back(x.back());
+        decimated_y.push_back(y.back());
+
+        return decimated;
+    }
+
+    IntegralObserver::IntegralObserver(Trajectory &trajectory): m_trajectory(trajectory) {}
 
-    void IntegralObserver::operator()(const std::vector<double> &x, double t) {
+    void IntegralObserver::operator()(std::span<const double> x, double t) {
 #ifndef NDEBUG
-        if (m_times.size() != 0) {
-            int previous_time = m_times[m_times.size() - 1];
+        if (!m_trajectory.empty()) {
+            int previous_time = m_trajectory.times().back();
             int previous_time_decade = previous_time / 3650;
 
             int current_time_decade = t / 3650;
@@ -76,19 +224,413 @@ namespace Utilities {
         }
 #endif
 
-        m_states.push_back(x);
-        m_times.push_back(t);
+        m_trajectory.push_back(x, t);
+    }
+
+    CsvWriter::CsvWriter(const std::vector<std::string> &header, const std::filesystem::path &file_path, std::optional<int> precision, bool background, bool append):
+        output(openOutputStream(file_path, append)),
+        precision(precision),
+        buffer(BUFFER_SIZE),
+        background(background),
+        written_buffer(background ? BUFFER_SIZE : 0) {
+        if (append) {
+            return;
+        }
+
+        std::string header_line;
+
+        for (std::size_t column = 0; column < header.size(); column++) {
+            if (column != 0) {
+                header_line += ',';
+            }
+
+            header_line += header[column];
+        }
+
+        header_line += '\n';
+        output->write(header_line.data(), header_line.size());
+    }
+
+    CsvWriter::~CsvWriter() {
+        if (!closed && !failed) {
+            try {
+                close();
+            } catch (const std::exception &exception) {
+                fmt::print(stderr, "Error writing CSV: {}\n", exception.what());
+            }
+        }
+
+        // a pending write still refers to the buffers
+        if (write.valid()) {
+            write.wait();
+        }
+    }
+
+    void CsvWriter::writeBuffer() {
+        if (!background) {
+            try {
+                output->write(buffer.data(), buffer_used);
+            } catch (const std::exception &) {
+                failed = true;
+                throw;
+            }
+
+            buffer_used = 0;
+
+            return;
+        }
+
+        if (write.valid()) {
+            finishWrite();
+        }
+
+        std::swap(buffer, written_buffer);
+
+        write = std::async(std::launch::async, [this, size = buffer_used] {
+            output->write(written_buffer.data(), size);
+        });
+
+        buffer_used = 0;
+    }
+
+    void CsvWriter::finishWrite() {
+        try {
+            write.get();
+        } catch (const std::exception &) {
+            failed = true;
+            throw;
+        }
+    }
+
+    void CsvWriter::writeRows(const std::vector<std::span<const double>> &columns) {
+        if (failed) {
+            throw std::runtime_error("Writing the CSV failed before");
+        }
+
+        const std::size_t rows = columns.empty() ? 0 : columns[0].size();
+
+        for (const auto &column : columns) {
+            if (column.size() != rows) {
+                throw std::invalid_argument("Columns with different lengths");
+            }
+        }
+
+        // a shortest round trip double takes at most 24 characters, a precision adds at most 8 to it's digits
+        // and each value is followed by a separator
+        const std::size_t value_size = (precision ? std::size_t(*precision) + 8 : 24) + 1;
+        const std::size_t row_size = columns.size() * value_size;
+
+        const auto write_rows = [&](auto format) {
+            for (std::size_t row = 0; row < rows; row++) {
+                if (buffer.size() - buffer_used < row_size) {
+                    writeBuffer();
+                }
+
+                char *position = buffer.data() + buffer_used;
+                char *const end = buffer.data() + buffer.size();
+
+                for (const auto &column : columns) {
+                    position = format(position, end, column[row]);
+                    *position++ = ',';
+                }
+
+                // the last separator becomes the end of the line
+                *(position - 1) = '\n';
+                buffer_used = std::size_t(position - buffer.data());
+            }
+        };
+
+        // chosen once instead of for every value
+        if (precision) {
+            write_rows([precision = *precision](char *position, char *end, double value) {
+                return std::to_chars(position, end, value, std::chars_format::general, precision).ptr;
+            });
+        } else {
+            write_rows([](char *position, char *end, double value) {
+                return std::to_chars(position, end, value).ptr;
+            });
+        }
+    }
+
+    void CsvWriter::flush() {
+        if (failed) {
+            throw std::runtime_error("Writing the CSV failed before");
+        }
+
+        writeBuffer();
+
+        if (write.valid()) {
+            finishWrite();
+        }
+
+        try {
+            output->flush();
+        } catch (const std::exception &) {
+            failed = true;
+            throw;
+        }
+    }
+
+    void CsvWriter::close() {
+        flush();
+
+        try {
+            output->close();
+        } catch (const std::exception &) {
+            failed = true;
+            throw;
+        }
+
+        closed = true;
+    }
+
+    CsvSink::CsvSink(const std::vector<std::string> &header, const std::filesystem::path &file_path, bool append, std::optional<int> precision):
+        file_path(file_path),
+        writer(header, file_path, precision, true, append) {}
+
+    void CsvSink::writeBlock(const Trajectory &block) {
+        writer.writeRows(block.columns());
+    }
+
+    std::uintmax_t CsvSink::flush() {
+        writer.flush();
+
+        return std::filesystem::file_size(file_path);
+    }
+
+    void CsvSink::close() {
+        writer.close();
+    }
+
+    constexpr std::string_view COLUMNAR_MAGIC = "IECPCOLS";
+    // offset of the total sample count in the header of a columnar file
+    constexpr std::streamoff SAMPLE_COUNT_OFFSET = 24;
+
+    // rounds size up to the 8 byte alignment of the columnar format
+    constexpr std::size_t padded(std::size_t size) {
+        return (size + 7) & ~std::size_t(7);
+    }
+
+    template<class Integer>
+    Integer toLittleEndian(Integer value) {
+        if constexpr (std::endian::native == std::endian::big) {
+            return std::byteswap(value);
+        }
+
+        return value;
+    }
+
+    BinarySink::BinarySink(const std::vector<std::string> &header, const std::filesystem::path &file_path, bool append, Precision precision):
+        file_path(file_path),
+        file(file_path, append ? std::ios::binary | std::ios::in | std::ios::out : std::ios::binary | std::ios::out | std::ios::trunc),
+        precision(precision) {
+        if (!file) {
+            throw std::runtime_error("Couldn't open " + file_path.string());
+        }
+
+        const std::uint32_t value_size = precision == Precision::Double ? sizeof(double) : sizeof(float);
+
+        if (append) {
+            // the sample count in the header may be stale if the run was interrupted, so it's recounted from
+            // the batches, which also checks that they're complete
+            char magic[8];
+            std::uint32_t version = 0;
+            std::uint32_t file_value_size = 0;
+            std::uint64_t column_count = 0;
+            std::uint64_t header_sample_count = 0;
+
+            file.read(magic, sizeof(magic));
+            file.read(reinterpret_cast<char *>(&version), sizeof(version));
+            file.read(reinterpret_cast<char *>(&file_value_size), sizeof(file_value_size));
+            file.read(reinterpret_cast<char *>(&column_count), sizeof(column_count));
+            file.read(reinterpret_cast<char *>(&header_sample_count), sizeof(header_sample_count));
+
+            if (!file || std::string_view(magic, sizeof(magic)) != COLUMNAR_MAGIC || toLittleEndian(version) != VERSION || toLittleEndian(file_value_size) != value_size || toLittleEndian(column_count) != header.size()) {
+                throw std::runtime_error(file_path.string() + " doesn't have the layout of this output");
+            }
+
+            for (const auto &name : header) {
+                std::uint64_t name_length = 0;
+                file.read(reinterpret_cast<char *>(&name_length), sizeof(name_length));
+                name_length = toLittleEndian(name_length);
+
+                if (!file || name_length != name.size()) {
+                    throw std::runtime_error(file_path.string() + " doesn't have the columns of this output");
+                }
+
+                std::string file_name(padded(name.size()), '\0');
+                file.read(file_name.data(), std::streamsize(file_name.size()));
+
+                if (!file || std::string_view(file_name.data(), name.size()) != name) {
+                    throw std::runtime_error(file_path.string() + " doesn't have the columns of this output");
+                }
+            }
+
+            const std::uintmax_t file_size = std::filesystem::file_size(file_path);
+            std::uintmax_t position = std::uintmax_t(file.tellg());
+
+            while (file && position < file_size) {
+                std::uint64_t batch_samples = 0;
+                file.read(reinterpret_cast<char *>(&batch_samples), sizeof(batch_samples));
+                batch_samples = toLittleEndian(batch_samples);
+
+                position += sizeof(batch_samples) + padded(batch_samples * sizeof(double)) + (header.size() - 1) * padded(batch_samples * value_size);
+                sample_count += batch_samples;
+                file.seekg(std::streamoff(position));
+            }
+
+            if (!file || position != file_size) {
+                throw std::runtime_error(file_path.string() + " ends in the middle of a batch");
+            }
+
+            file.seekp(0, std::ios::end);
+
+            return;
+        }
+
+        buffer.insert(buffer.end(), COLUMNAR_MAGIC.begin(), COLUMNAR_MAGIC.end());
+
+        const auto append_integer = [this](auto value) {
+            value = toLittleEndian(value);
+            const char *bytes = reinterpret_cast<const char *>(&value);
+
+            buffer.insert(buffer.end(), bytes, bytes + sizeof(value));
+        };
+
+        append_integer(VERSION);
+        append_integer(value_size);
+        append_integer(std::uint64_t(header.size()));
+        append_integer(std::uint64_t(0));
+
+        for (const auto &name : header) {
+            append_integer(std::uint64_t(name.size()));
+            buffer.insert(buffer.end(), name.begin(), name.end());
+            buffer.resize(padded(buffer.size()));
+        }
+
+        file.write(buffer.data(), std::streamsize(buffer.size()));
+        check();
     }
 
-    void writeCsv(const std::vector<std::string> &header, const std::vector<std::vector<double>> &values, const std::filesystem::path &file_path) {
-        fmt::ostream file = fmt::output_file(file_path.string());
+    template<class Value>
+    void BinarySink::appendColumn(std::span<const double> column) {
+        const std::size_t start = buffer.size();
+        buffer.resize(start + padded(column.size() * sizeof(Value)));
 
-        file.print("{}\n", fmt::join(header, ","));
+        Value *values = reinterpret_cast<Value *>(buffer.data() + start);
 
-        for (auto line : values) {
-            file.print("{}\n", fmt::join(line, ","));
+        for (std::size_t i = 0; i < column.size(); i++) {
+            if constexpr (std::endian::native == std::endian::big) {
+                using Bits = std::conditional_t<sizeof(Value) == 8, std::uint64_t, std::uint32_t>;
+
+                values[i] = std::bit_cast<Value>(std::byteswap(std::bit_cast<Bits>(Value(column[i]))));
+            } else {
+                values[i] = Value(column[i]);
+            }
         }
+    }
+
+    void BinarySink::writeBlock(const Trajectory &block) {
+        if (block.empty()) {
+            return;
+        }
+
+        const std::uint64_t batch_samples = toLittleEndian(std::uint64_t(block.size()));
+
+        buffer.resize(sizeof(batch_samples));
+        std::memcpy(buffer.data(), &batch_samples, sizeof(batch_samples));
+
+        const std::vector<std::span<const double>> columns = block.columns();
+
+        // the time, adjacent samples can be closer than the spacing of floats
+        appendColumn<double>(columns.front());
+
+        for (std::size_t column = 1; column < columns.size(); column++) {
+            if (precision == Precision::Double) {
+                appendColumn<double>(columns[column]);
+            } else {
+                appendColumn<float>(columns[column]);
+            }
+        }
+
+        file.write(buffer.data(), std::streamsize(buffer.size()));
+        check();
+        sample_count += block.size();
+    }
+
+    void BinarySink::writeSampleCount() {
+        const std::uint64_t count = toLittleEndian(sample_count);
+
+        file.seekp(SAMPLE_COUNT_OFFSET);
+        file.write(reinterpret_cast<const char *>(&count), sizeof(count));
+        file.seekp(0, std::ios::end);
+        check();
+    }
+
+    void BinarySink::check() const {
+        if (!file) {
+            throw std::runtime_error("Couldn't write " + file_path.string());
+        }
+    }
+
+    std::uintmax_t BinarySink::flush() {
+        writeSampleCount();
+        file.flush();
+        check();
 
+        return std::filesystem::file_size(file_path);
+    }
+
+    void BinarySink::close() {
+        writeSampleCount();
         file.close();
+        check();
+    }
+
+    StreamingObserver::StreamingObserver(TrajectorySink &sink, std::size_t block_size, std::size_t state_size): m_sink(sink), m_block_size(block_size), m_block(state_size) {
+        m_block.reserve(block_size);
+    }
+
+    void StreamingObserver::operator()(std::span<const double> x, double t) {
+#ifndef NDEBUG
+        int previous_time_decade = int(previous_time) / 3650;
+        int current_time_decade = t / 3650;
+
+        if (previous_time_decade != current_time_decade) {
+            auto current_decade_time = std::chrono::high_resolution_clock::now();
+
+            auto current_decade_duration = std::chrono::duration_cast<std::chrono::microseconds>(current_decade_time - this->previous_decade_time);
+            fmt::print(fg(fmt::color::dark_golden_rod) | fmt::emphasis::bold, "->Finished decade {}. Decade simulation duration: {} ({})\n", current_time_decade, current_decade_duration, std::chrono::duration_cast<std::chrono::seconds>(current_decade_duration));
+
+            this->previous_decade_time = current_decade_time;
+        }
+
+        previous_time = t;
+#endif
+
+        m_block.push_back(x, t);
+
+        if (m_block.size() >= m_block_size) {
+            flush();
+        }
+    }
+
+    void StreamingObserver::flush() {
+        if (m_block.empty()) {
+            return;
+        }
+
+        m_sink.writeBlock(m_block);
+
+        // clear keeps the capacity so the next block doesn't allocate again
+        m_block.clear();
+    }
+
+    void writeCsv(const std::vector<std::string> &header, const std::vector<std::span<const double>> &columns, const std::filesystem::path &file_path, std::optional<int> precision) {
+        // the file is written while the next buffer is being formatted
+        CsvWriter writer(header, file_path, precision, true);
+
+        writer.writeRows(columns);
+        writer.close();
     }
 }  // namespace Utilities
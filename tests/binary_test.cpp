@@ -0,0 +1,271 @@
+// checks that Utilities::BinarySink writes columns that read back to the same values, with the time as
+// float64 in single precision files too, across several batches and when appending, and that it throws once
+// the file can't be written or appended to, run by ctest
+#include <fmt/base.h>
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "trajectory.hpp"
+#include "utilities.hpp"
+
+static constexpr std::size_t STATE_SIZE = 3;
+// uneven on purpose, so that the batches need padding, with a single sample one among them
+static const std::vector<std::size_t> BLOCK_SIZES = {1000, 1, 777};
+static const std::vector<std::size_t> APPENDED_BLOCK_SIZES = {333};
+
+using Precision = Utilities::BinarySink::Precision;
+
+// what's read back from a file, every value widened to double
+struct Columns {
+    std::uint32_t version = 0;
+    std::uint32_t value_size = 0;
+    std::vector<std::string> names;
+    std::uint64_t sample_count = 0;
+    std::vector<std::vector<double>> values;
+};
+
+// the format as documented with Utilities::BinarySink, on a little endian machine
+static Columns readColumns(const std::filesystem::path &file_path) {
+    std::ifstream file(file_path, std::ios::binary);
+    const std::string contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    std::size_t position = 0;
+
+    const auto read = [&](void *destination, std::size_t size) {
+        if (position + size > contents.size()) {
+            throw std::runtime_error("Truncated file");
+        }
+
+        std::memcpy(destination, contents.data() + position, size);
+        position += size;
+    };
+
+    const auto pad = [&] {
+        position = (position + 7) & ~std::size_t(7);
+    };
+
+    Columns columns;
+    std::string magic(8, '\0');
+    std::uint64_t column_count = 0;
+
+    read(magic.data(), magic.size());
+
+    if (magic != "IECPCOLS") {
+        throw std::runtime_error("Wrong magic " + magic);
+    }
+
+    read(&columns.version, sizeof(columns.version));
+    read(&columns.value_size, sizeof(columns.value_size));
+    read(&column_count, sizeof(column_count));
+    read(&columns.sample_count, sizeof(columns.sample_count));
+
+    for (std::uint64_t column = 0; column < column_count; column++) {
+        std::uint64_t name_length = 0;
+        read(&name_length, sizeof(name_length));
+
+        std::string name(name_length, '\0');
+        read(name.data(), name.size());
+        pad();
+
+        columns.names.push_back(name);
+    }
+
+    columns.values.resize(column_count);
+
+    while (position < contents.size()) {
+        std::uint64_t batch_samples = 0;
+        read(&batch_samples, sizeof(batch_samples));
+
+        for (std::uint64_t column = 0; column < column_count; column++) {
+            for (std::uint64_t sample = 0; sample < batch_samples; sample++) {
+                if (column == 0 || columns.value_size == sizeof(double)) {
+                    double value = 0;
+                    read(&value, sizeof(value));
+                    columns.values[column].push_back(value);
+                } else {
+                    float value = 0;
+                    read(&value, sizeof(value));
+                    columns.values[column].push_back(value);
+                }
+            }
+
+            pad();
+        }
+    }
+
+    return columns;
+}
+
+// times closer together than floats can tell apart near the end of a long run
+static Trajectory randomBlock(std::size_t samples, double &time, std::mt19937_64 &generator) {
+    std::uniform_real_distribution<double> step(1e-9, 1e-3);
+    std::lognormal_distribution<double> value(0, 5);
+    Trajectory block(STATE_SIZE);
+    std::vector<double> x(STATE_SIZE);
+
+    for (std::size_t sample = 0; sample < samples; sample++) {
+        for (auto &variable : x) {
+            variable = value(generator);
+        }
+
+        block.push_back(x, time);
+        time += step(generator);
+    }
+
+    return block;
+}
+
+static bool checkRoundTrip(const std::filesystem::path &directory, Precision precision) {
+    const std::filesystem::path file_path = directory / "values.bin";
+    const std::vector<std::string> header = {"Time", "a", "bb", "a longer name"};
+
+    std::mt19937_64 generator(42);
+    double time = 36000;
+    std::vector<Trajectory> blocks;
+
+    for (const std::size_t samples : BLOCK_SIZES) {
+        blocks.push_back(randomBlock(samples, time, generator));
+    }
+
+    {
+        Utilities::BinarySink sink(header, file_path, false, precision);
+
+        for (std::size_t block = 0; block < BLOCK_SIZES.size(); block++) {
+            sink.writeBlock(blocks[block]);
+        }
+
+        sink.close();
+    }
+
+    for (const std::size_t samples : APPENDED_BLOCK_SIZES) {
+        blocks.push_back(randomBlock(samples, time, generator));
+    }
+
+    {
+        Utilities::BinarySink sink(header, file_path, true, precision);
+
+        for (std::size_t block = BLOCK_SIZES.size(); block < blocks.size(); block++) {
+            sink.writeBlock(blocks[block]);
+        }
+
+        sink.close();
+    }
+
+    const Columns columns = readColumns(file_path);
+    const std::uint32_t value_size = precision == Precision::Double ? sizeof(double) : sizeof(float);
+    bool passed = true;
+
+    if (columns.version != Utilities::BinarySink::VERSION || columns.value_size != value_size || columns.names != header) {
+        fmt::print(stderr, "Header of version {} with {} byte values doesn't match what was written\n", columns.version, columns.value_size);
+
+        return false;
+    }
+
+    std::size_t sample_count = 0;
+    std::size_t mismatches = 0;
+
+    for (const auto &block : blocks) {
+        for (std::size_t sample = 0; sample < block.size(); sample++, sample_count++) {
+            if (sample_count >= columns.values[0].size()) {
+                continue;
+            }
+
+            for (std::size_t column = 0; column <= STATE_SIZE; column++) {
+                const double written = column == 0 ? block.times()[sample] : block.state(column - 1)[sample];
+                // the time is never rounded
+                const double expected = column == 0 || precision == Precision::Double ? written : double(float(written));
+                const double value = columns.values[column][sample_count];
+
+                if (std::bit_cast<std::uint64_t>(value) != std::bit_cast<std::uint64_t>(expected) && mismatches++ == 0) {
+                    fmt::print(stderr, "Sample {} of column {} reads back as {} instead of {}\n", sample_count, column, value, expected);
+                }
+            }
+        }
+    }
+
+    if (columns.sample_count != sample_count || columns.values[0].size() != sample_count) {
+        fmt::print(stderr, "{} samples in the header and {} in the batches instead of {}\n", columns.sample_count, columns.values[0].size(), sample_count);
+        passed = false;
+    }
+
+    if (mismatches != 0) {
+        fmt::print(stderr, "{} values didn't read back ({} byte values)\n", mismatches, value_size);
+        passed = false;
+    }
+
+    // a file of another layout can't be continued
+    const Precision other_precision = precision == Precision::Double ? Precision::Single : Precision::Double;
+
+    for (const auto &[other_header, appended_precision] : {std::pair(header, other_precision), std::pair(std::vector<std::string>{"Time", "a", "bb", "c"}, precision)}) {
+        try {
+            Utilities::BinarySink sink(other_header, file_path, true, appended_precision);
+
+            fmt::print(stderr, "Appending with a different layout didn't throw ({} byte values)\n", value_size);
+            passed = false;
+        } catch (const std::runtime_error &) {
+        }
+    }
+
+    return passed;
+}
+
+// a full disk, every write to /dev/full fails
+static bool checkWriteError(Precision precision) {
+    if (!std::filesystem::exists("/dev/full")) {
+        fmt::print("/dev/full is missing, skipping the write error check\n");
+
+        return true;
+    }
+
+    std::mt19937_64 generator(42);
+    double time = 0;
+
+    try {
+        Utilities::BinarySink sink({"Time", "a", "b", "c"}, "/dev/full", false, precision);
+        sink.writeBlock(randomBlock(100000, time, generator));
+        sink.close();
+    } catch (const std::runtime_error &) {
+        return true;
+    }
+
+    fmt::print(stderr, "Writing to /dev/full didn't throw\n");
+
+    return false;
+}
+
+int main() {
+    if constexpr (std::endian::native != std::endian::little) {
+        fmt::print("The reader only handles little endian machines, skipping\n");
+
+        return 0;
+    }
+
+    const std::filesystem::path directory = std::filesystem::temp_directory_path() / "immuno-endocrine-binary-test";
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory);
+
+    std::size_t failures = 0;
+    std::size_t checks = 0;
+
+    for (const Precision precision : {Precision::Double, Precision::Single}) {
+        failures += !checkRoundTrip(directory, precision);
+        failures += !checkWriteError(precision);
+        checks += 2;
+    }
+
+    std::filesystem::remove_all(directory);
+
+    fmt::print("{} of {} checks failed\n", failures, checks);
+
+    return failures == 0 ? 0 : 1;
+}
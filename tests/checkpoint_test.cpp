@@ -0,0 +1,121 @@
+// checks that a streamed run resumed from it's checkpoint writes the same bytes as a run that was never
+// stopped, both when it was interrupted part of the way and when a finished run is extended, run by ctest
+#include <fmt/base.h>
+
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "cortisol_cytokines_simulation.hpp"
+#include "utilities.hpp"
+
+static constexpr int DAYS = 40;
+static constexpr double CHECKPOINT_INTERVAL = 10;
+
+struct Case {
+    std::string name;
+    bool binary;
+    Utilities::BinarySink::Precision binary_precision;
+    // in days, 0 keeps the one of the default configuration
+    double output_interval;
+    std::optional<double> steady_state_tolerance;
+    // days of the first run, the second one resumes from it's checkpoint to DAYS
+    int first_days;
+    // written after the checkpoint as if the first run had been interrupted while streaming
+    bool interrupted;
+};
+
+// the cycle is reached on day 28 with a tolerance of 1e-3, the runs are resumed before and after it
+static const std::vector<Case> CASES = {
+    {"csv", false, Utilities::BinarySink::Precision::Double, 0, std::nullopt, 20, false},
+    {"csv-interrupted", false, Utilities::BinarySink::Precision::Double, 1.0 / 24, std::nullopt, 20, true},
+    {"binary", true, Utilities::BinarySink::Precision::Double, 0, std::nullopt, 20, false},
+    {"binary-interrupted", true, Utilities::BinarySink::Precision::Double, 1.0 / 24, std::nullopt, 20, true},
+    {"float32", true, Utilities::BinarySink::Precision::Single, 1.0 / 24, std::nullopt, 20, true},
+    {"steady-state-searching", false, Utilities::BinarySink::Precision::Double, 1.0 / 24, 1e-3, 20, false},
+    {"steady-state-reached", true, Utilities::BinarySink::Precision::Double, 0, 1e-3, 30, true}
+};
+
+static void simulate(const Case &test_case, int days, bool resume) {
+    CortisolCytokinesSimulation simulation(std::filesystem::path(), days, false, !test_case.binary);
+    simulation.setStream(true);
+    simulation.setBinary(test_case.binary);
+    simulation.setBinaryPrecision(test_case.binary_precision);
+    simulation.setCheckpointPath("output/checkpoint");
+    simulation.setCheckpointInterval(CHECKPOINT_INTERVAL);
+    simulation.setResume(resume);
+
+    if (test_case.output_interval > 0) {
+        simulation.setOutputInterval(test_case.output_interval);
+    }
+
+    if (test_case.steady_state_tolerance) {
+        simulation.setSteadyStateTolerance(*test_case.steady_state_tolerance);
+    }
+
+    simulation.startSimulation();
+}
+
+static std::string readFile(const std::filesystem::path &file_path) {
+    std::ifstream file(file_path, std::ios::binary);
+
+    return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+// the simulation writes to output/ in the working directory
+static bool check(const Case &test_case, const std::filesystem::path &directory) {
+    const std::filesystem::path output_name = test_case.binary ? "values.bin" : "values.csv";
+    const std::filesystem::path whole_directory = directory / test_case.name / "whole";
+    const std::filesystem::path resumed_directory = directory / test_case.name / "resumed";
+
+    std::filesystem::create_directories(whole_directory / "output");
+    std::filesystem::create_directories(resumed_directory / "output");
+
+    std::filesystem::current_path(whole_directory);
+    simulate(test_case, DAYS, false);
+
+    std::filesystem::current_path(resumed_directory);
+    simulate(test_case, test_case.first_days, false);
+
+    if (test_case.interrupted) {
+        std::ofstream output(resumed_directory / "output" / output_name, std::ios::binary | std::ios::app);
+        output << "samples written after the checkpoint";
+    }
+
+    simulate(test_case, DAYS, true);
+
+    const std::string whole_output = readFile(whole_directory / "output" / output_name);
+    const std::string resumed_output = readFile(resumed_directory / "output" / output_name);
+
+    if (whole_output.empty() || resumed_output != whole_output) {
+        fmt::print(stderr, "{}: the resumed output ({} bytes) differs from the uninterrupted one ({} bytes)\n", test_case.name, resumed_output.size(), whole_output.size());
+
+        return false;
+    }
+
+    return true;
+}
+
+int main() {
+    const std::filesystem::path directory = std::filesystem::temp_directory_path() / "immuno-endocrine-checkpoint-test";
+    std::filesystem::remove_all(directory);
+
+    std::size_t failures = 0;
+
+    for (const auto &test_case : CASES) {
+        if (!check(test_case, directory)) {
+            failures++;
+        }
+    }
+
+    std::filesystem::current_path(directory.parent_path());
+    std::filesystem::remove_all(directory);
+
+    fmt::print("{} of {} cases failed\n", failures, CASES.size());
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,189 @@
+// checks that Utilities::CsvWriter writes values that read back to the same doubles, across several buffers and
+// when appending, and that it throws once the file can't be written, run by ctest
+#include <fmt/base.h>
+
+#include <bit>
+#include <charconv>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <optional>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "utilities.hpp"
+
+// enough rows to fill CsvWriter::BUFFER_SIZE a few times over
+static constexpr std::size_t ROW_COUNT = 100000;
+static constexpr std::size_t COLUMN_COUNT = 5;
+static constexpr int PRECISION = 6;
+
+// doubles of every magnitude and sign, with the special values at the start
+static std::vector<std::vector<double>> randomColumns(std::size_t rows, std::mt19937_64 &generator) {
+    std::vector<std::vector<double>> columns(COLUMN_COUNT, std::vector<double>(rows));
+
+    for (auto &column : columns) {
+        for (auto &value : column) {
+            do {
+                value = std::bit_cast<double>(std::uint64_t(generator()));
+            } while (!std::isfinite(value));
+        }
+    }
+
+    const std::vector<double> special_values = {0.0, -0.0, 1.0, std::numeric_limits<double>::denorm_min(), -std::numeric_limits<double>::max(), std::numeric_limits<double>::infinity(), 0.1};
+
+    for (std::size_t row = 0; row < special_values.size() && row < rows; row++) {
+        columns[row % COLUMN_COUNT][row] = special_values[row];
+    }
+
+    return columns;
+}
+
+static std::vector<std::span<const double>> spans(const std::vector<std::vector<double>> &columns) {
+    return std::vector<std::span<const double>>(columns.begin(), columns.end());
+}
+
+// reads the file back as it's header line and the value of every row, column by column
+static std::vector<std::vector<double>> readCsv(const std::filesystem::path &file_path, std::string &header_line) {
+    std::ifstream file(file_path);
+    std::vector<std::vector<double>> columns(COLUMN_COUNT);
+    std::string line;
+
+    std::getline(file, header_line);
+
+    while (std::getline(file, line)) {
+        const char *position = line.data();
+        const char *const end = line.data() + line.size();
+
+        for (auto &column : columns) {
+            double value = 0;
+            const auto result = std::from_chars(position, end, value);
+
+            if (result.ec != std::errc()) {
+                throw std::runtime_error("Unreadable value in " + line);
+            }
+
+            column.push_back(value);
+            position = result.ptr + 1;
+        }
+
+        if (position != end + 1) {
+            throw std::runtime_error("Wrong number of values in " + line);
+        }
+    }
+
+    return columns;
+}
+
+static bool checkRoundTrip(const std::filesystem::path &directory, bool background, std::optional<int> precision) {
+    const std::filesystem::path file_path = directory / "values.csv";
+    const std::vector<std::string> header = {"T", "a", "b", "c", "d"};
+
+    std::mt19937_64 generator(42);
+    const auto first_columns = randomColumns(ROW_COUNT, generator);
+    const auto appended_columns = randomColumns(ROW_COUNT / 10, generator);
+
+    {
+        Utilities::CsvWriter writer(header, file_path, precision, background);
+        writer.writeRows(spans(first_columns));
+        writer.close();
+    }
+
+    {
+        Utilities::CsvWriter writer(header, file_path, precision, background, true);
+        writer.writeRows(spans(appended_columns));
+        writer.close();
+    }
+
+    std::string header_line;
+    const auto columns = readCsv(file_path, header_line);
+    bool passed = header_line == "T,a,b,c,d";
+
+    if (!passed) {
+        fmt::print(stderr, "Header {} instead of T,a,b,c,d\n", header_line);
+    }
+
+    if (columns[0].size() != ROW_COUNT + ROW_COUNT / 10) {
+        fmt::print(stderr, "{} rows instead of {}\n", columns[0].size(), ROW_COUNT + ROW_COUNT / 10);
+
+        return false;
+    }
+
+    // the shortest text reads back to exactly the same double, a precision rounds to that many digits
+    const double allowed_error = precision ? 0.5 * std::pow(10.0, 1 - *precision) : 0;
+    std::size_t mismatches = 0;
+
+    for (std::size_t column = 0; column < COLUMN_COUNT; column++) {
+        for (std::size_t row = 0; row < columns[column].size(); row++) {
+            const double expected = row < ROW_COUNT ? first_columns[column][row] : appended_columns[column][row - ROW_COUNT];
+            const double value = columns[column][row];
+            const bool same = precision ? (value == expected || std::fabs(value - expected) <= allowed_error * std::fabs(expected)) : std::bit_cast<std::uint64_t>(value) == std::bit_cast<std::uint64_t>(expected);
+
+            if (!same && mismatches++ == 0) {
+                fmt::print(stderr, "Row {} of column {} reads back as {} instead of {}\n", row, column, value, expected);
+            }
+        }
+    }
+
+    if (mismatches != 0) {
+        fmt::print(stderr, "{} values didn't read back ({} writer, precision {})\n", mismatches, background ? "background" : "sequential", precision.value_or(0));
+        passed = false;
+    }
+
+    return passed;
+}
+
+// a full disk, every write to /dev/full fails
+static bool checkWriteError(bool background) {
+    if (!std::filesystem::exists("/dev/full")) {
+        fmt::print("/dev/full is missing, skipping the write error check\n");
+
+        return true;
+    }
+
+    std::mt19937_64 generator(42);
+    const auto columns = randomColumns(ROW_COUNT, generator);
+
+    try {
+        Utilities::CsvWriter writer({"T", "a", "b", "c", "d"}, "/dev/full", std::nullopt, background);
+        writer.writeRows(spans(columns));
+        writer.close();
+    } catch (const std::runtime_error &) {
+        return true;
+    }
+
+    fmt::print(stderr, "Writing to /dev/full didn't throw ({} writer)\n", background ? "background" : "sequential");
+
+    return false;
+}
+
+int main() {
+    const std::filesystem::path directory = std::filesystem::temp_directory_path() / "immuno-endocrine-csv-test";
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory);
+
+    std::size_t failures = 0;
+    std::size_t checks = 0;
+
+    for (const bool background : {false, true}) {
+        for (const auto precision : {std::optional<int>(), std::optional<int>(PRECISION)}) {
+            failures += !checkRoundTrip(directory, background, precision);
+            checks++;
+        }
+
+        failures += !checkWriteError(background);
+        checks++;
+    }
+
+    std::filesystem::remove_all(directory);
+
+    fmt::print("{} of {} checks failed\n", failures, checks);
+
+    return failures == 0 ? 0 : 1;
+}
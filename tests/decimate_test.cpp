@@ -0,0 +1,130 @@
+// checks that Utilities::decimateMinMax keeps the endpoints and the minimum and maximum of every bucket, in
+// order and without points of it's own, run by ctest
+#include <fmt/base.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "utilities.hpp"
+
+static constexpr std::size_t POINT_COUNT = 100000;
+// a single bucket, fewer than the points of a day, and about the width of a figure in pixels
+static const std::vector<std::size_t> BUCKET_COUNTS = {1, 7, 640};
+
+// unevenly spaced, like the steps of an adaptive solver, a smooth curve with noise and single point spikes
+static void randomSeries(std::vector<double> &x, std::vector<double> &y, std::mt19937_64 &generator) {
+    std::exponential_distribution<double> step(1);
+    std::normal_distribution<double> noise(0, 0.1);
+    std::bernoulli_distribution spike(1e-4);
+
+    x.resize(POINT_COUNT);
+    y.resize(POINT_COUNT);
+
+    double time = 0;
+
+    for (std::size_t point = 0; point < POINT_COUNT; point++) {
+        x[point] = time;
+        y[point] = std::sin(time / 1000) + noise(generator) + (spike(generator) ? 100 : 0);
+        time += step(generator);
+    }
+}
+
+static bool checkSeries(const std::vector<double> &x, const std::vector<double> &y, std::size_t bucket_count) {
+    const auto [decimated_x, decimated_y] = Utilities::decimateMinMax(x, y, bucket_count);
+    bool passed = true;
+
+    if (decimated_x.size() != decimated_y.size() || decimated_x.size() > 2 * bucket_count + 2) {
+        fmt::print(stderr, "{} and {} points for {} buckets\n", decimated_x.size(), decimated_y.size(), bucket_count);
+
+        return false;
+    }
+
+    if (decimated_x.front() != x.front() || decimated_y.front() != y.front() || decimated_x.back() != x.back() || decimated_y.back() != y.back()) {
+        fmt::print(stderr, "The endpoints weren't kept with {} buckets\n", bucket_count);
+        passed = false;
+    }
+
+    // every point is one of the series, in the same order
+    for (std::size_t point = 0; point < decimated_x.size(); point++) {
+        const auto original = std::lower_bound(x.begin(), x.end(), decimated_x[point]);
+
+        if (original == x.end() || *original != decimated_x[point] || y[std::size_t(original - x.begin())] != decimated_y[point] || (point > 0 && decimated_x[point] <= decimated_x[point - 1])) {
+            fmt::print(stderr, "Point ({}, {}) isn't in the series or out of order with {} buckets\n", decimated_x[point], decimated_y[point], bucket_count);
+
+            return false;
+        }
+    }
+
+    // the same buckets as decimateMinMax, between the endpoints
+    const double buckets_per_x = double(bucket_count) / (x.back() - x.front());
+    std::vector<double> minima(bucket_count, INFINITY);
+    std::vector<double> maxima(bucket_count, -INFINITY);
+    std::vector<double> decimated_minima(bucket_count, INFINITY);
+    std::vector<double> decimated_maxima(bucket_count, -INFINITY);
+
+    const auto bucket = [&](double point_x) {
+        return std::min(std::size_t((point_x - x.front()) * buckets_per_x), bucket_count - 1);
+    };
+
+    for (std::size_t point = 1; point < x.size() - 1; point++) {
+        minima[bucket(x[point])] = std::min(minima[bucket(x[point])], y[point]);
+        maxima[bucket(x[point])] = std::max(maxima[bucket(x[point])], y[point]);
+    }
+
+    for (std::size_t point = 1; point < decimated_x.size() - 1; point++) {
+        decimated_minima[bucket(decimated_x[point])] = std::min(decimated_minima[bucket(decimated_x[point])], decimated_y[point]);
+        decimated_maxima[bucket(decimated_x[point])] = std::max(decimated_maxima[bucket(decimated_x[point])], decimated_y[point]);
+    }
+
+    if (minima != decimated_minima || maxima != decimated_maxima) {
+        fmt::print(stderr, "The extrema of some of the {} buckets weren't kept\n", bucket_count);
+        passed = false;
+    }
+
+    return passed;
+}
+
+int main() {
+    std::mt19937_64 generator(42);
+    std::vector<double> x;
+    std::vector<double> y;
+    randomSeries(x, y, generator);
+
+    std::size_t failures = 0;
+    std::size_t checks = 0;
+
+    for (const std::size_t bucket_count : BUCKET_COUNTS) {
+        failures += !checkSeries(x, y, bucket_count);
+        checks++;
+    }
+
+    // too short to be worth decimating, returned as it is
+    const std::vector<double> short_x(x.begin(), x.begin() + 10);
+    const std::vector<double> short_y(y.begin(), y.begin() + 10);
+    const auto [same_x, same_y] = Utilities::decimateMinMax(short_x, short_y, 640);
+
+    if (same_x != short_x || same_y != short_y) {
+        fmt::print(stderr, "A series shorter than the buckets was changed\n");
+        failures++;
+    }
+
+    checks++;
+
+    try {
+        Utilities::decimateMinMax(x, short_y, 640);
+
+        fmt::print(stderr, "Series of different lengths didn't throw\n");
+        failures++;
+    } catch (const std::invalid_argument &) {
+    }
+
+    checks++;
+
+    fmt::print("{} of {} checks failed\n", failures, checks);
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,95 @@
+// checks CortisolCytokinesModel::jacobian against central finite differences of the right hand side at random
+// interior states, run by ctest
+#include <fmt/base.h>
+#include <fmt/ranges.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <random>
+
+#include "cortisol_cytokines_integrator.hpp"
+#include "cortisol_cytokines_model.hpp"
+
+// states around the settled one, each variable scaled by up to a decade either way
+static constexpr std::size_t STATE_COUNT = 1000;
+static constexpr double SCALE_DECADES = 1;
+// central differences are accurate to O(step^2), with the rounding error growing as 1 / step
+static constexpr double RELATIVE_STEP = 1e-6;
+static constexpr double TOLERANCE = 1e-5;
+
+// largest difference between the jacobian and the finite differences at x, relative to the size of each
+// entry with 1 as the floor, nan if any of them isn't finite
+static double finiteDifferenceError(const CortisolCytokinesModel &model, const CortisolCytokinesModel::State &x, double T) {
+    using State = CortisolCytokinesModel::State;
+
+    CortisolCytokinesModel::Jacobian J;
+    State dfdt;
+    model.jacobian(x, J, T, dfdt);
+
+    double largest_error = 0;
+
+    for (std::size_t j = 0; j < x.size(); j++) {
+        const double step = RELATIVE_STEP * std::max(1.0, std::fabs(x[j]));
+        State forward = x;
+        State backward = x;
+        forward[j] += step;
+        backward[j] -= step;
+
+        State forward_dxdt;
+        State backward_dxdt;
+        model(forward, forward_dxdt, T);
+        model(backward, backward_dxdt, T);
+
+        for (std::size_t i = 0; i < x.size(); i++) {
+            const double difference = (forward_dxdt[i] - backward_dxdt[i]) / (2 * step);
+            const double error = std::fabs(difference - J[i][j]) / std::max(1.0, std::fabs(difference));
+
+            // std::max would drop a nan
+            if (!std::isfinite(error)) {
+                return NAN;
+            }
+
+            largest_error = std::max(largest_error, error);
+        }
+    }
+
+    return largest_error;
+}
+
+int main() {
+    const CortisolCytokinesModel model;
+    CortisolCytokinesModel::State settled_state = CortisolCytokinesModel::DEFAULT_INITIAL_CONDITIONS;
+
+    // every variable is away from it's initial value, the il-6 starting at 0 included
+    CortisolCytokinesIntegrator().integrate(model, settled_state, 0.0, 2.0);
+
+    std::mt19937_64 generator(42);
+    std::uniform_real_distribution<double> decades(-SCALE_DECADES, SCALE_DECADES);
+    std::uniform_real_distribution<double> times(0.0, 1.0);
+
+    std::size_t failures = 0;
+    double largest_error = 0;
+
+    for (std::size_t sample = 0; sample < STATE_COUNT; sample++) {
+        CortisolCytokinesModel::State x;
+
+        for (std::size_t i = 0; i < x.size(); i++) {
+            x[i] = settled_state[i] * std::pow(10.0, decades(generator));
+        }
+
+        const double T = times(generator);
+        const double error = finiteDifferenceError(model, x, T);
+
+        if (!(error <= TOLERANCE)) {
+            fmt::print(stderr, "Jacobian differs from the finite differences by {:.3g} at T = {} and x = {}\n", error, T, fmt::join(x, ", "));
+            failures++;
+        } else {
+            largest_error = std::max(largest_error, error);
+        }
+    }
+
+    fmt::print("{} of {} states failed, largest error of the others {:.3g}\n", failures, STATE_COUNT, largest_error);
+
+    return failures == 0 ? 0 : 1;
+}
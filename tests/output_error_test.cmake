@@ -0,0 +1,22 @@
+# checks that the program exits with status 4 when it's output can't be written, by pointing the output file at
+# /dev/full, run by ctest as
+#   cmake -DPROGRAM=<immuno-endocrine-cpp> -DOUTPUT=<file in output/> -DARGUMENTS=<arguments> -DDIRECTORY=<scratch directory> -P output_error_test.cmake
+separate_arguments(ARGUMENTS)
+
+file(REMOVE_RECURSE "${DIRECTORY}")
+file(MAKE_DIRECTORY "${DIRECTORY}/output")
+file(CREATE_LINK /dev/full "${DIRECTORY}/output/${OUTPUT}" SYMBOLIC)
+
+execute_process(
+    COMMAND "${PROGRAM}" --no-plot ${ARGUMENTS}
+    WORKING_DIRECTORY "${DIRECTORY}"
+    RESULT_VARIABLE result
+    OUTPUT_QUIET
+    ERROR_VARIABLE error
+)
+
+file(REMOVE_RECURSE "${DIRECTORY}")
+
+if(NOT result EQUAL 4)
+    message(FATAL_ERROR "Exited with ${result} instead of 4 writing ${OUTPUT} to a full disk:\n${error}")
+endif()
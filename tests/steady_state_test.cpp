@@ -0,0 +1,115 @@
+// checks that integrating with steady state detection observes the same samples as a plain integration, with
+// values that differ by no more than the steady state tolerance allows, run by ctest
+#include <fmt/base.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "cortisol_cytokines_integrator.hpp"
+#include "cortisol_cytokines_model.hpp"
+
+struct Case {
+    double days;
+    // in minutes, 0 observes every step
+    double output_interval;
+    double steady_state_tolerance;
+    // whether the cycle has to be reached, so that the replay is what's compared
+    bool replayed;
+};
+
+static const std::vector<Case> CASES = {
+    // the output interval doesn't divide the day, the integration continues once the cycle is reached
+    {30, 1000, 1e-2, false},
+    {120, 1000, 1e-4, false},
+    // a day is 24 output intervals, the cycle is replayed on them
+    {30, 60, 1e-2, true},
+    {120, 60, 1e-4, true}
+};
+
+using Samples = std::vector<std::pair<double, CortisolCytokinesModel::State>>;
+
+static bool check(const Case &test_case) {
+    const CortisolCytokinesModel model;
+    CortisolCytokinesIntegrator integrator;
+    integrator.setOutputInterval(test_case.output_interval / (24 * 60));
+
+    Samples plain_samples;
+    Samples periodic_samples;
+    CortisolCytokinesModel::State plain_state = CortisolCytokinesModel::DEFAULT_INITIAL_CONDITIONS;
+    CortisolCytokinesModel::State periodic_state = CortisolCytokinesModel::DEFAULT_INITIAL_CONDITIONS;
+
+    integrator.integrate(model, plain_state, 0.0, test_case.days, [&](const CortisolCytokinesModel::State &x, double T) {
+        plain_samples.emplace_back(T, x);
+    });
+
+    const double cycle_time = integrator.integratePeriodic(model, periodic_state, 0.0, test_case.days, CortisolCytokinesModel::PERIOD, test_case.steady_state_tolerance, [&](const CortisolCytokinesModel::State &x, double T) {
+        periodic_samples.emplace_back(T, x);
+    });
+
+    const auto error = [&](const CortisolCytokinesModel::State &x, const CortisolCytokinesModel::State &expected) {
+        double largest_error = 0;
+
+        for (std::size_t i = 0; i < x.size(); i++) {
+            const double error = std::fabs(x[i] - expected[i]) / std::max(1.0, std::fabs(expected[i]));
+
+            // std::max would drop a nan
+            largest_error = std::isfinite(error) ? std::max(largest_error, error) : INFINITY;
+        }
+
+        return largest_error;
+    };
+
+    // a reached cycle can still move by up to the tolerance every period, which the replay leaves out
+    const double remaining_periods = (test_case.days - cycle_time) / CortisolCytokinesModel::PERIOD;
+    const double allowed_error = (1 + remaining_periods) * test_case.steady_state_tolerance;
+    bool passed = true;
+
+    if (test_case.replayed && !(cycle_time < test_case.days)) {
+        fmt::print(stderr, "No cycle was reached in {} days with a tolerance of {}\n", test_case.days, test_case.steady_state_tolerance);
+        passed = false;
+    }
+
+    if (periodic_samples.size() != plain_samples.size()) {
+        fmt::print(stderr, "{} samples instead of {}\n", periodic_samples.size(), plain_samples.size());
+
+        return false;
+    }
+
+    double largest_error = error(periodic_state, plain_state);
+
+    for (std::size_t sample = 0; sample < plain_samples.size(); sample++) {
+        if (periodic_samples[sample].first != plain_samples[sample].first) {
+            fmt::print(stderr, "Sample {} at T = {} instead of {}\n", sample, periodic_samples[sample].first, plain_samples[sample].first);
+
+            return false;
+        }
+
+        largest_error = std::max(largest_error, error(periodic_samples[sample].second, plain_samples[sample].second));
+    }
+
+    if (!(largest_error <= allowed_error)) {
+        fmt::print(stderr, "Differs from the plain integration by {:.3g}, more than {:.3g}\n", largest_error, allowed_error);
+        passed = false;
+    }
+
+    fmt::print("{} days every {} minutes with a tolerance of {}: cycle reached on day {}, largest difference {:.3g}\n", test_case.days, test_case.output_interval, test_case.steady_state_tolerance, cycle_time, largest_error);
+
+    return passed;
+}
+
+int main() {
+    std::size_t failures = 0;
+
+    for (const auto &test_case : CASES) {
+        if (!check(test_case)) {
+            failures++;
+        }
+    }
+
+    fmt::print("{} of {} cases failed\n", failures, CASES.size());
+
+    return failures == 0 ? 0 : 1;
+}